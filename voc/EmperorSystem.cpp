@@ -24,7 +24,9 @@ CEmperorSystem::CEmperorSystem()
     m_psTextureManager(nullptr),
     m_psPhysicsManager(nullptr),
     m_psFontManager(nullptr),
-    m_psSpriteManager(nullptr)
+    m_psAtlasManager(nullptr),
+    m_psSpriteManager(nullptr),
+    m_psTransformManager(nullptr)
 {
 }
 
@@ -40,11 +42,21 @@ void CEmperorSystem::init()
     initializeTextureManager();
     initializePhysicsManager();
     initializeFontManager();
+    initializeAtlasManager();
     initializeSpriteManager();
+    initializeTransformManager();
 }
 
 void CEmperorSystem::destroy()
 {
+    if (m_psTransformManager)
+    {
+        m_psTransformManager->destroy();
+
+        delete m_psTransformManager;
+        m_psTransformManager = nullptr;
+    }
+
     if (m_psSpriteManager)
     {
         m_psSpriteManager->destroy();
@@ -53,6 +65,14 @@ void CEmperorSystem::destroy()
         m_psSpriteManager = nullptr;
     }
 
+    if (m_psAtlasManager)
+    {
+        m_psAtlasManager->destroy();
+
+        delete m_psAtlasManager;
+        m_psAtlasManager = nullptr;
+    }
+
     if (m_psFontManager)
     {
         m_psFontManager->destroy();
@@ -105,11 +125,27 @@ void CEmperorSystem::update()
     if (m_psRenderer)
         m_psRenderer->update();
 
+    if (m_psTextureManager)
+        m_psTextureManager->update();
+
     if (m_psEventHandler)
         m_psEventHandler->update();
 
     if (m_psPhysicsManager)
         m_psPhysicsManager->update();
+
+    //! only bodies that moved reach the transforms, so only their nodes
+    //! are recomputed below
+    if (m_psPhysicsManager && m_psTransformManager)
+    {
+        CPhysicsManager::SMovedBodies const &moved = m_psPhysicsManager->getMovedBodies();
+        if (!moved.transform.empty())
+            m_psTransformManager->setTransforms(&moved.transform[0], &moved.position[0],
+                    &moved.rotation[0], moved.transform.size());
+    }
+
+    if (m_psTransformManager)
+        m_psTransformManager->update();
 }
 
 void CEmperorSystem::initializeRenderer()
@@ -152,7 +188,7 @@ void CEmperorSystem::initializePhysicsManager()
     if (!m_psPhysicsManager)
         fprintf(stderr, "[ERR] System Error: Unable to initialize physics manager.");
 
-    m_psPhysicsManager->init();
+    m_psPhysicsManager->init(CPhysicsManager::loadConfig("./build/configs/app_config.xml"));
 }
 
 void CEmperorSystem::initializeFontManager()
@@ -164,13 +200,29 @@ void CEmperorSystem::initializeFontManager()
     m_psFontManager->init();
 }
 
+void CEmperorSystem::initializeAtlasManager()
+{
+    m_psAtlasManager = new CAtlasManager();
+    if (!m_psAtlasManager)
+        fprintf(stderr, "[ERR] System Error: Unable to initialize atlas manager.");
+
+    m_psAtlasManager->init();
+}
+
 void CEmperorSystem::initializeSpriteManager()
 {
     m_psSpriteManager = new CSpriteManager();
     if (!m_psSpriteManager)
         fprintf(stderr, "[ERR] System Error: Unable to initialize font manager.");
 
-    m_psSpriteManager->init();
+    m_psSpriteManager->init(m_psTextureManager, m_psAtlasManager);
+}
+
+void CEmperorSystem::initializeTransformManager()
+{
+    m_psTransformManager = new CTransformManager();
+    if (!m_psTransformManager)
+        fprintf(stderr, "[ERR] System Error: Unable to initialize transform manager.");
 }
 
 unsigned int CEmperorSystem::getRealTime() const
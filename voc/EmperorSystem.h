@@ -27,6 +27,8 @@
 #include "system/PhysicsManager.h"
 #include "system/FontManager.h"
 #include "system/SpriteManager.h"
+#include "system/AtlasManager.h"
+#include "system/TransformManager.h"
 
 class CEmperorSystem
 {
@@ -45,6 +47,8 @@ public:
     CPhysicsManager* getPhysicsManager() const { return m_psPhysicsManager; }
     CFontManager* getFontManager() const { return m_psFontManager; }
     CSpriteManager* getSpriteManager() const { return m_psSpriteManager; }
+    CAtlasManager* getAtlasManager() const { return m_psAtlasManager; }
+    CTransformManager* getTransformManager() const { return m_psTransformManager; }
 
 protected:
     void initializeRenderer();
@@ -53,7 +57,9 @@ protected:
     void initializeTextureManager();
     void initializePhysicsManager();
     void initializeFontManager();
+    void initializeAtlasManager();
     void initializeSpriteManager();
+    void initializeTransformManager();
 
     unsigned int getRealTime() const;
 
@@ -64,7 +70,9 @@ private:
     CTextureManager *m_psTextureManager;
     CPhysicsManager *m_psPhysicsManager;
     CFontManager *m_psFontManager;
+    CAtlasManager *m_psAtlasManager;
     CSpriteManager *m_psSpriteManager;
+    CTransformManager *m_psTransformManager;
 };
 
 #endif /* end of include guard: EMPERORSYSTEM_H */
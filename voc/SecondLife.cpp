@@ -50,47 +50,47 @@ void CSecondLife::init()
 
     for (size_t i = 0; i < sizeof(drops) / sizeof(drops[0]); i++)
     {
-        bool validated = true;
-        if (validated)
-        {
-            m_mShader[drops[i].name.c_str()] = SShader(drops[i].name.c_str());
-
-            std::string vertShaderSource = drops[i].vert;
-            std::string fragShaderSource = drops[i].frag;
+        SShader shader(drops[i].name.c_str());
 
-            GLuint vertShader = helpers::createShader(GL_VERTEX_SHADER, vertShaderSource);
-            GLuint fragShader = helpers::createShader(GL_FRAGMENT_SHADER, fragShaderSource);
+        std::string vertShaderSource = drops[i].vert;
+        std::string fragShaderSource = drops[i].frag;
 
-            validated = validated && helpers::checkShader(vertShader, vertShaderSource);
-            validated = validated && helpers::checkShader(fragShader, fragShaderSource);
+        GLuint vertShader = helpers::createShader(GL_VERTEX_SHADER, vertShaderSource);
+        GLuint fragShader = helpers::createShader(GL_FRAGMENT_SHADER, fragShaderSource);
 
-            m_mShader[drops[i].name.c_str()].program = glCreateProgram();
-            glAttachShader(m_mShader[drops[i].name.c_str()].program, vertShader);
-            glAttachShader(m_mShader[drops[i].name.c_str()].program, fragShader);
+        bool validated = true;
+        validated = validated && helpers::checkShader(vertShader, vertShaderSource);
+        validated = validated && helpers::checkShader(fragShader, fragShaderSource);
 
-            glDeleteShader(vertShader);
-            glDeleteShader(fragShader);
+        shader.program = glCreateProgram();
+        glAttachShader(shader.program, vertShader);
+        glAttachShader(shader.program, fragShader);
 
-            glBindAttribLocation(m_mShader[drops[i].name.c_str()].program, helpers::semantic::attr::POSITION, "position");
-            glBindAttribLocation(m_mShader[drops[i].name.c_str()].program, helpers::semantic::attr::TEXCOORD, "texcoord");
+        glDeleteShader(vertShader);
+        glDeleteShader(fragShader);
 
-            glLinkProgram(m_mShader[drops[i].name.c_str()].program);
-            validated = helpers::checkProgram(m_mShader[drops[i].name.c_str()].program);
+        glBindAttribLocation(shader.program, helpers::semantic::attr::POSITION, "position");
+        glBindAttribLocation(shader.program, helpers::semantic::attr::TEXCOORD, "texcoord");
 
-        }
+        glLinkProgram(shader.program);
+        validated = helpers::checkProgram(shader.program);
 
         if (validated)
-            m_mShader[drops[i].name.c_str()].uniforms = helpers::getActiveUniforms(m_mShader[drops[i].name.c_str()].program);
+            shader.uniforms = helpers::getActiveUniforms(shader.program);
+
+        m_mShaderHandle[drops[i].name] = m_sShader.insert(shader);
     }
 
-    m_psSystem->getTextureManager()->load("./build/assets/textures/nz.jpg", 0, GL_BGR);
-    m_psSystem->getTextureManager()->load("./build/assets/textures/nx.jpg", 1, GL_BGR);
-    m_psSystem->getTextureManager()->load("./build/assets/textures/pz.jpg", 2, GL_BGR);
-    m_psSystem->getTextureManager()->load("./build/assets/textures/px.jpg", 3, GL_BGR);
-    m_psSystem->getTextureManager()->load("./build/assets/textures/py.jpg", 4, GL_BGR);
-    m_psSystem->getTextureManager()->load("./build/assets/textures/ny.jpg", 5, GL_BGR);
+    m_psSystem->getTextureManager()->loadAsync("./build/assets/textures/nz.jpg", 0, GL_BGR);
+    m_psSystem->getTextureManager()->loadAsync("./build/assets/textures/nx.jpg", 1, GL_BGR);
+    m_psSystem->getTextureManager()->loadAsync("./build/assets/textures/pz.jpg", 2, GL_BGR);
+    m_psSystem->getTextureManager()->loadAsync("./build/assets/textures/px.jpg", 3, GL_BGR);
+    m_psSystem->getTextureManager()->loadAsync("./build/assets/textures/py.jpg", 4, GL_BGR);
+    m_psSystem->getTextureManager()->loadAsync("./build/assets/textures/ny.jpg", 5, GL_BGR);
 
     m_psSystem->getFontManager()->load("serif", "/usr/share/fonts/dejavu/DejaVuSerif.ttf");
+    m_psSystem->getFontManager()->load("sans", "/usr/share/fonts/dejavu/DejaVuSans.ttf");
+    m_psSystem->getFontManager()->addFallbackFont("sans");
 
     stagePerspectiveObjects();
 
@@ -112,29 +112,49 @@ void CSecondLife::init()
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
     glFrontFace(GL_CCW);
 
-    glUseProgram(m_mShader["perspective"].program);
-    glUniform4fv(m_mShader["perspective"].uniforms["diffuse"], 1, &glm::vec4(1.0, 0.5, 0.0, 1.0)[0]);
+    SShader &perspective = *m_sShader.get(m_mShaderHandle["perspective"]);
+    glUseProgram(perspective.program);
+    glUniform4fv(perspective.uniforms["diffuse"], 1, &glm::vec4(1.0, 0.5, 0.0, 1.0)[0]);
     glUseProgram(0);
 }
 
 void CSecondLife::destroy()
 {
-    std::vector<SMeshNode>::iterator it = m_vMesh.begin();
-    for (; it != m_vMesh.end(); it++)
+    SMeshNode *node = m_sMesh.begin();
+    for (; node != m_sMesh.end(); node++)
+    {
+        m_psSystem->getTransformManager()->remove(node->transform);
+        if (node->body != CPhysicsManager::INVALID_BODY)
+            m_psSystem->getPhysicsManager()->remove(node->body);
+    }
+
+    for (size_t i = 0; i < m_vSoftMesh.size(); i++)
     {
-        std::vector<SMesh>::iterator n = it->mesh.begin();
-        for (; n != it->mesh.end(); n++)
+        for (int r = 0; r < STREAM_REGIONS; r++)
         {
-            glDeleteBuffers(SMesh::MAX, &n->buffers[0]);
-            glDeleteVertexArrays(1, &n->object);
+            if (m_vSoftMesh[i].fences[r])
+                glDeleteSync(m_vSoftMesh[i].fences[r]);
         }
-
-        it->mesh.clear();
     }
+    m_vSoftMesh.clear();
+
+    std::vector<SMesh>::iterator it = m_vMeshData.begin();
+    for (; it != m_vMeshData.end(); it++)
+        glDeleteBuffers(SMesh::MAX, it->buffers);
 
-    m_vMesh.clear();
-    glDeleteProgram(m_mShader["perspective"].program);
-    glDeleteProgram(m_mShader["font"].program);
+    if (!m_sMeshDraw.object.empty())
+        glDeleteVertexArrays(m_sMeshDraw.object.size(), &m_sMeshDraw.object[0]);
+
+    m_vMeshData.clear();
+    m_sMeshDraw = SMeshDraws();
+    m_sMesh.clear();
+
+    SShader *shader = m_sShader.begin();
+    for (; shader != m_sShader.end(); shader++)
+        glDeleteProgram(shader->program);
+
+    m_sShader.clear();
+    m_mShaderHandle.clear();
 }
 
 void CSecondLife::update()
@@ -187,34 +207,42 @@ void CSecondLife::update()
     glClearDepth(1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(m_mShader["perspective"].program);
-    m_sMvp.setProjection(m_mShader["perspective"].uniforms["projection"], SModelViewProjection::PERSPECTIVE);
-    glUniformMatrix4fv(m_mShader["perspective"].uniforms["modelview"], 1, GL_FALSE, &m_sMvp.getModelView(view)[0][0]);
+    streamSoftBodies();
+
+    SShader &perspective = *m_sShader.get(m_mShaderHandle["perspective"]);
+    SShader &font = *m_sShader.get(m_mShaderHandle["font"]);
+
+    glUseProgram(perspective.program);
+    m_sMvp.setProjection(perspective.uniforms["projection"], SModelViewProjection::PERSPECTIVE);
+    glUniformMatrix4fv(perspective.uniforms["modelview"], 1, GL_FALSE, &m_sMvp.getModelView(view)[0][0]);
+    GLint textured = perspective.uniforms["textured"];
     push();
         //! recursive rendering
-        glUniformMatrix4fv(m_mShader["perspective"].uniforms["modelview"], 1, GL_FALSE, &m_sCurrentMatrix[0][0]);
-        std::vector<SMeshNode>::iterator it = m_vMesh.begin();
-        for (; it != m_vMesh.end(); it++)
+        glUniformMatrix4fv(perspective.uniforms["modelview"], 1, GL_FALSE, &m_sCurrentMatrix[0][0]);
+        cullPerspectiveObjects();
+        for (size_t i = 0; i < m_sMesh.size(); i++)
         {
-            if (it->visible)
+            SMeshNode const *it = &m_sMesh[i];
+            if (it->visible && m_sCulling.visible[i])
             {
                 push();
-                    glUniformMatrix4fv(m_mShader["perspective"].uniforms["modelview"], 1, GL_FALSE, &m_sCurrentMatrix[0][0]);
-                    std::vector<SMesh>::iterator n = it->mesh.begin();
-                    for (; n != it->mesh.end(); n++)
+                    m_sCurrentMatrix = m_sCulling.modelview[i];
+                    glUniformMatrix4fv(perspective.uniforms["modelview"], 1, GL_FALSE, &m_sCurrentMatrix[0][0]);
+                    for (unsigned int n = it->first; n < it->first + it->count; n++)
                     {
-                        if (n->options.texture)
+                        GLuint texture = m_sMeshDraw.texture[n];
+                        if (texture != NO_TEXTURE)
                         {
-                            m_psSystem->getTextureManager()->bindTexture(n->properties.texture);
-                            glUniform1i(m_mShader["perspective"].uniforms["textured"], GL_TRUE);
+                            m_psSystem->getTextureManager()->bindTexture(texture);
+                            glUniform1i(textured, GL_TRUE);
                         }
 
-                        glBindVertexArray(n->object);
-                            glDrawElements(n->properties.type, n->properties.count, GL_UNSIGNED_INT, 0);
+                        glBindVertexArray(m_sMeshDraw.object[n]);
+                            glDrawElements(m_sMeshDraw.type[n], m_sMeshDraw.count[n], GL_UNSIGNED_INT, 0);
                         glBindVertexArray(0);
 
-                        if (n->options.texture)
-                            glUniform1i(m_mShader["perspective"].uniforms["textured"], GL_FALSE);
+                        if (texture != NO_TEXTURE)
+                            glUniform1i(textured, GL_FALSE);
                     }
                 pop();
             }
@@ -222,16 +250,45 @@ void CSecondLife::update()
     pop();
     glUseProgram(0);
 
-    glUseProgram(m_mShader["font"].program);
-    m_sMvp.setProjection(m_mShader["font"].uniforms["projection"], SModelViewProjection::ORTHOGRAPHIC);
+    glUseProgram(font.program);
+    m_sMvp.setProjection(font.uniforms["projection"], SModelViewProjection::ORTHOGRAPHIC);
     push();
         m_psSystem->getFontManager()->setFontType("serif");
-        m_psSystem->getFontManager()->setPixelSize(m_mShader["font"].uniforms["offset"], 48);
+        m_psSystem->getFontManager()->setPixelSize(font.uniforms["offset"], 48);
         m_psSystem->getFontManager()->write("Hello, World!", glm::vec2(10.0));
     pop();
     glUseProgram(0);
 }
 
+void CSecondLife::cullPerspectiveObjects()
+{
+    size_t count = m_sMesh.size();
+
+    m_sCulling.world.resize(count);
+    m_sCulling.modelview.resize(count);
+    m_sCulling.bounds.resize(count);
+    m_sCulling.visible.resize(count);
+
+    if (count == 0)
+        return;
+
+    CTransformManager *transforms = m_psSystem->getTransformManager();
+    for (size_t i = 0; i < count; i++)
+    {
+        m_sCulling.world[i] = transforms->getWorld(m_sMesh[i].transform);
+        m_sCulling.bounds[i] = m_sMesh[i].bounds;
+    }
+
+    glm::vec4 planes[6];
+    mathkernels::extractFrustum(m_sMvp.constant.perspective * m_sCurrentMatrix, planes);
+
+    //! bounds into world space and against the frustum, then the model
+    //! view of every node, each as one batch
+    mathkernels::transformAABBs(&m_sCulling.world[0], &m_sCulling.bounds[0], &m_sCulling.bounds[0], count);
+    mathkernels::cullAABBs(planes, 6, &m_sCulling.bounds[0], &m_sCulling.visible[0], count);
+    mathkernels::multiply(m_sCurrentMatrix, &m_sCulling.world[0], &m_sCulling.modelview[0], count);
+}
+
 void CSecondLife::push()
 {
     m_vStack.push(m_sCurrentMatrix);
@@ -243,7 +300,53 @@ void CSecondLife::pop()
     m_vStack.pop();
 }
 
-void CSecondLife::loadWaveObjFile(char const *file, char const *path, bool visible, float offset)
+unsigned int CSecondLife::addMesh(SMesh &&mesh, GLuint object, GLenum type, GLint count,
+        GLuint texture)
+{
+    m_sMeshDraw.object.push_back(object);
+    m_sMeshDraw.type.push_back(type);
+    m_sMeshDraw.count.push_back(count);
+    m_sMeshDraw.texture.push_back(texture);
+
+    m_vMeshData.push_back(std::move(mesh));
+    return m_vMeshData.size() - 1;
+}
+
+void CSecondLife::reserveMeshes(unsigned int count)
+{
+    count += m_vMeshData.size();
+
+    m_sMeshDraw.object.reserve(count);
+    m_sMeshDraw.type.reserve(count);
+    m_sMeshDraw.count.reserve(count);
+    m_sMeshDraw.texture.reserve(count);
+
+    m_vMeshData.reserve(count);
+}
+
+void *CSecondLife::beginUpload(GLenum target, GLsizeiptr size)
+{
+    glBufferData(target, size, NULL, GL_STATIC_DRAW);
+
+    void *data = glMapBufferRange(target, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    if (data == NULL)
+        data = m_sArena.allocate(size);
+
+    return data;
+}
+
+void CSecondLife::endUpload(GLenum target, void *data, GLsizeiptr size)
+{
+    if (m_sArena.contains(data))
+        glBufferSubData(target, 0, size, data);
+    else if (glUnmapBuffer(target) == GL_FALSE)
+        fprintf(stderr, "[ERR] Scene Error: Buffer contents lost while mapped.");
+}
+
+void CSecondLife::loadWaveObjFile(char const *file, char const *path, bool visible, float offset,
+        bool collide)
 {
     std::vector<tinyobj::shape_t> shapes;
     std::string err = tinyobj::LoadObj(shapes, file, path);
@@ -251,51 +354,102 @@ void CSecondLife::loadWaveObjFile(char const *file, char const *path, bool visib
     if (!err.empty())
         fprintf(stderr, "[ERR] Scene Error: Unable to load obj file.");
 
+    reserveMeshes(shapes.size());
+
+    //! the offset moves every vertex, so it is part of what makes two
+    //! loads the same collision mesh
+    CPhysicsManager *physics = m_psSystem->getPhysicsManager();
+    std::string collisionKey;
+    glm::uint32 collisionMesh = CPhysicsManager::INVALID_MESH;
+    std::vector<glm::vec3> collisionVertices;
+    std::vector<glm::uint32> collisionIndices;
+    if (collide)
+    {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "@%g", offset);
+        collisionKey = std::string(file) + suffix;
+        collisionMesh = physics->findMesh(collisionKey);
+        collide = collisionMesh == CPhysicsManager::INVALID_MESH;
+    }
+
+    //! the collision arrays are handed to the physics manager, so they are
+    //! sized once up front rather than staged in the arena
+    if (collide)
+    {
+        size_t vertices = 0, indices = 0;
+        for (int i = 0; i < shapes.size(); i++)
+        {
+            vertices += shapes[i].mesh.positions.size() / 3;
+            indices += shapes[i].mesh.indices.size();
+        }
+
+        collisionVertices.reserve(vertices);
+        collisionIndices.reserve(indices);
+    }
+
     SMeshNode meshNode;
-    std::vector<SMesh> holder;
+    meshNode.first = m_vMeshData.size();
+
+    glm::vec3 lower(INFINITY), upper(-INFINITY);
     for (int i = 0; i < shapes.size(); i++)
     {
         SMesh mesh;
+        GLuint object = 0;
 
-        GLsizei elementCount;
-        GLsizeiptr elementSize;
-        std::vector<glm::uint32> elementData;
+        std::vector<float> const &positions = shapes[i].mesh.positions;
+        std::vector<unsigned int> const &indices = shapes[i].mesh.indices;
 
-        GLsizei vertexCount;
-        GLsizeiptr vertexSize;
-        std::vector<glm::vec3> vertexData;
+        assert((positions.size() % 3) == 0);
+        GLsizei vertexCount = positions.size() / 3;
+        GLsizeiptr vertexSize = vertexCount * sizeof(glm::vec3);
 
-        assert((shapes[i].mesh.positions.size() % 3) == 0);
-        for (int v = 0; v < shapes[i].mesh.positions.size() / 3; v++)
-        {
-            vertexData.push_back(glm::vec3(
-                shapes[i].mesh.positions[3 * v + 0] - offset,
-                shapes[i].mesh.positions[3 * v + 1] - offset,
-                shapes[i].mesh.positions[3 * v + 2] - offset));
-        }
-
-        vertexCount = vertexData.size();
-        vertexSize = vertexCount * sizeof(glm::vec3);
-
-        for (int f = 0; f < shapes[i].mesh.indices.size(); f++)
-            elementData.push_back(shapes[i].mesh.indices[f]);
+        GLsizei elementCount = indices.size();
+        GLsizeiptr elementSize = elementCount * sizeof(glm::uint32);
 
-        elementCount = elementData.size();
-        elementSize = elementCount * sizeof(glm::uint32);
-        mesh.properties.count = elementCount;
+        if (vertexCount == 0 || elementCount == 0)
+            continue;
 
-        glGenVertexArrays(1, &mesh.object);
+        glGenVertexArrays(1, &object);
 
         glGenBuffers(SMesh::MAX, &mesh.buffers[0]);
         glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
-        glBufferData(GL_ARRAY_BUFFER, vertexSize, &vertexData[0], GL_STATIC_DRAW);
+        glm::vec3 *vertexData = static_cast<glm::vec3 *>(beginUpload(GL_ARRAY_BUFFER, vertexSize));
+        for (int v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 position(
+                positions[3 * v + 0] - offset,
+                positions[3 * v + 1] - offset,
+                positions[3 * v + 2] - offset);
+
+            vertexData[v] = position;
+            lower = glm::min(lower, position);
+            upper = glm::max(upper, position);
+        }
+        endUpload(GL_ARRAY_BUFFER, vertexData, vertexSize);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+        //! every shape goes into one collision mesh, indices rebased; read
+        //! from the source, never back from the mapped buffer
+        if (collide)
+        {
+            glm::uint32 base = collisionVertices.size();
+            for (int v = 0; v < vertexCount; v++)
+                collisionVertices.push_back(glm::vec3(
+                    positions[3 * v + 0] - offset,
+                    positions[3 * v + 1] - offset,
+                    positions[3 * v + 2] - offset));
+
+            for (int e = 0; e < elementCount - elementCount % 3; e++)
+                collisionIndices.push_back(base + indices[e]);
+        }
+
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[SMesh::ELEMENT]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, &elementData[0], GL_STATIC_DRAW);
+        void *elementData = beginUpload(GL_ELEMENT_ARRAY_BUFFER, elementSize);
+        memcpy(elementData, &indices[0], elementSize);
+        endUpload(GL_ELEMENT_ARRAY_BUFFER, elementData, elementSize);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        glBindVertexArray(mesh.object);
+        glBindVertexArray(object);
             glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
             glVertexAttribPointer(helpers::semantic::attr::POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -304,64 +458,83 @@ void CSecondLife::loadWaveObjFile(char const *file, char const *path, bool visib
             glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
         glBindVertexArray(0);
 
-        mesh.properties.type = GL_TRIANGLES;
-        holder.push_back(mesh);
+        addMesh(std::move(mesh), object, GL_TRIANGLES, elementCount);
     }
 
     meshNode.name = file;
-    meshNode.mesh = holder;
+    meshNode.count = m_vMeshData.size() - meshNode.first;
+    if (meshNode.count > 0)
+    {
+        meshNode.bounds.center = (lower + upper) * 0.5f;
+        meshNode.bounds.extent = (upper - lower) * 0.5f;
+    }
     meshNode.visible = visible;
-    m_vMesh.push_back(meshNode);
+    meshNode.transform = m_psSystem->getTransformManager()->create();
+
+    if (collide)
+        collisionMesh = physics->createMesh(collisionKey, std::move(collisionVertices),
+                std::move(collisionIndices), collisionKey + ".bvh");
+
+    if (collisionMesh != CPhysicsManager::INVALID_MESH)
+    {
+        CPhysicsManager::SBodyDesc desc;
+        desc.shape = CPhysicsManager::E_PS_MESH;
+        desc.mesh = collisionMesh;
+        desc.mass = 0.0;
+        meshNode.body = physics->spawn(desc);
+        physics->bind(meshNode.body, meshNode.transform);
+    }
+
+    m_sMesh.insert(std::move(meshNode));
+
+    m_sArena.reset();
 }
 
 void CSecondLife::stagePerspectiveObjects()
 {
+    //! grid, six skybox faces and the cube
+    reserveMeshes(8);
+
     //! populate grid object
     {
         SMeshNode meshNode;
+        meshNode.first = m_vMeshData.size();
         SMesh mesh;
-        std::vector<SMesh> holder;
-
-        GLsizei elementCount;
-        GLsizeiptr elementSize;
-        std::vector<glm::uint32> elementData;
-
-        GLsizei vertexCount;
-        GLsizeiptr vertexSize;
-        std::vector<glm::vec3> vertexData;
-
-        float extent = 30.0, step = 1.0, h = -0.6;
-        for (int line = -extent; line <= extent; line += step)
-        {
-            vertexData.push_back(glm::vec3(line, h, extent));
-            vertexData.push_back(glm::vec3(line, h, -extent));
-
-            vertexData.push_back(glm::vec3(extent, h, line));
-            vertexData.push_back(glm::vec3(-extent, h, line));
-        }
+        GLuint object = 0;
 
-        vertexCount = vertexData.size();
-        vertexSize = vertexCount * sizeof(glm::vec3);
+        int extent = 30, step = 1;
+        float h = -0.6;
 
-        elementCount = vertexCount;
-        elementSize = elementCount * sizeof(glm::uint32);
-        for (int i = 0; i < elementCount; i++)
-            elementData.push_back(i);
+        GLsizei vertexCount = 4 * ((2 * extent) / step + 1);
+        GLsizeiptr vertexSize = vertexCount * sizeof(glm::vec3);
 
-        mesh.properties.count = elementCount;
+        GLsizei elementCount = vertexCount;
+        GLsizeiptr elementSize = elementCount * sizeof(glm::uint32);
 
-        glGenVertexArrays(1, &mesh.object);
+        glGenVertexArrays(1, &object);
 
         glGenBuffers(SMesh::MAX, &mesh.buffers[0]);
         glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
-        glBufferData(GL_ARRAY_BUFFER, vertexSize, &vertexData[0], GL_STATIC_DRAW);
+        glm::vec3 *vertexData = static_cast<glm::vec3 *>(beginUpload(GL_ARRAY_BUFFER, vertexSize));
+        for (int line = -extent, v = 0; line <= extent; line += step, v += 4)
+        {
+            vertexData[v + 0] = glm::vec3(line, h, extent);
+            vertexData[v + 1] = glm::vec3(line, h, -extent);
+
+            vertexData[v + 2] = glm::vec3(extent, h, line);
+            vertexData[v + 3] = glm::vec3(-extent, h, line);
+        }
+        endUpload(GL_ARRAY_BUFFER, vertexData, vertexSize);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[SMesh::ELEMENT]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, &elementData[0], GL_STATIC_DRAW);
+        glm::uint32 *elementData = static_cast<glm::uint32 *>(beginUpload(GL_ELEMENT_ARRAY_BUFFER, elementSize));
+        for (int i = 0; i < elementCount; i++)
+            elementData[i] = i;
+        endUpload(GL_ELEMENT_ARRAY_BUFFER, elementData, elementSize);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        glBindVertexArray(mesh.object);
+        glBindVertexArray(object);
             glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
             glVertexAttribPointer(helpers::semantic::attr::POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -370,19 +543,22 @@ void CSecondLife::stagePerspectiveObjects()
             glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
         glBindVertexArray(0);
 
-        mesh.properties.type = GL_LINES;
-        holder.push_back(mesh);
+        addMesh(std::move(mesh), object, GL_LINES, elementCount);
 
         meshNode.name = "grid";
-        meshNode.mesh = holder;
+        meshNode.bounds.center = glm::vec3(0.0, h, 0.0);
+        meshNode.bounds.extent = glm::vec3(extent, 0.0, extent);
+        meshNode.count = m_vMeshData.size() - meshNode.first;
         meshNode.visible = true;
-        m_vMesh.push_back(meshNode);
+        meshNode.transform = m_psSystem->getTransformManager()->create();
+        m_sMesh.insert(std::move(meshNode));
     }
 
     //! populate skybox object
     {
         float scale = 250.0;
         SMeshNode meshNode;
+        meshNode.first = m_vMeshData.size();
         helpers::SVertv3v2 vertexData[6][4] =
         {
             {
@@ -429,21 +605,19 @@ void CSecondLife::stagePerspectiveObjects()
             }
         };
 
-        std::vector<SMesh> holder;
         for (int i = 0;  i < 6; i++)
         {
             SMesh mesh;
+            GLuint object = 0;
 
             GLsizei const vertexCount = 4;
             GLsizeiptr const vertexSize = vertexCount * sizeof(helpers::SVertv3v2);
-                    
+
             GLsizei const elementCount = 4;
             GLsizeiptr const elementSize = elementCount * sizeof(glm::uint32);
             glm::uint32 elementData[] = { 0, 1, 2, 3 };
 
-            mesh.properties.count = elementCount;
-
-            glGenVertexArrays(1, &mesh.object);
+            glGenVertexArrays(1, &object);
 
             glGenBuffers(SMesh::MAX, &mesh.buffers[0]);
             glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
@@ -454,7 +628,7 @@ void CSecondLife::stagePerspectiveObjects()
             glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, elementData, GL_STATIC_DRAW);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-            glBindVertexArray(mesh.object);
+            glBindVertexArray(object);
                 glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
                 glVertexAttribPointer(helpers::semantic::attr::POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv3v2), BUFFER_OFFSET(0));
                 glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv3v2), BUFFER_OFFSET(sizeof(glm::vec3)));
@@ -465,23 +639,23 @@ void CSecondLife::stagePerspectiveObjects()
                 glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
             glBindVertexArray(0);
 
-            mesh.options.texture = true;
-            mesh.properties.texture = i;
-            mesh.properties.type = GL_TRIANGLE_FAN;
-            holder.push_back(mesh);
+            addMesh(std::move(mesh), object, GL_TRIANGLE_FAN, elementCount, i);
         }
 
         meshNode.name = "skybox";
-        meshNode.mesh = holder;
+        meshNode.bounds.extent = glm::vec3(scale);
+        meshNode.count = m_vMeshData.size() - meshNode.first;
         meshNode.visible = true;
-        m_vMesh.push_back(meshNode);
+        meshNode.transform = m_psSystem->getTransformManager()->create();
+        m_sMesh.insert(std::move(meshNode));
     }
 
     //! populate cube object
     {
         SMeshNode meshNode;
+        meshNode.first = m_vMeshData.size();
         SMesh mesh;
-        std::vector<SMesh> holder;
+        GLuint object = 0;
 
         float scale = 1.0 * 0.5;
         GLsizei const vertexCount = 12;
@@ -504,7 +678,6 @@ void CSecondLife::stagePerspectiveObjects()
 
         GLsizei const elementCount = 36;
         GLsizeiptr const elementSize = elementCount * sizeof(glm::uint32);
-        mesh.properties.count = elementCount;
 
         glm::uint32 elementData[36] =
         {
@@ -522,7 +695,7 @@ void CSecondLife::stagePerspectiveObjects()
             0, 10, 7
         };
 
-        glGenVertexArrays(1, &mesh.object);
+        glGenVertexArrays(1, &object);
 
         glGenBuffers(SMesh::MAX, &mesh.buffers[0]);
         glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
@@ -533,7 +706,7 @@ void CSecondLife::stagePerspectiveObjects()
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, elementData, GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        glBindVertexArray(mesh.object);
+        glBindVertexArray(object);
             glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
             glVertexAttribPointer(helpers::semantic::attr::POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv3v2), BUFFER_OFFSET(0));
             glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv3v2), BUFFER_OFFSET(sizeof(glm::vec3)));
@@ -544,13 +717,163 @@ void CSecondLife::stagePerspectiveObjects()
             glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
         glBindVertexArray(0);
 
-        mesh.properties.type = GL_TRIANGLES;
-        holder.push_back(mesh);
+        addMesh(std::move(mesh), object, GL_TRIANGLES, elementCount);
 
         meshNode.name = "cube";
-        meshNode.mesh = holder;
+        meshNode.bounds.extent = glm::vec3(scale);
+        meshNode.count = m_vMeshData.size() - meshNode.first;
         meshNode.visible = true;
-        m_vMesh.push_back(meshNode);
+        meshNode.transform = m_psSystem->getTransformManager()->create();
+        m_sMesh.insert(std::move(meshNode));
+    }
+
+    //! populate cloth object, hung by its top corners behind the cube
+    CPhysicsManager *physics = m_psSystem->getPhysicsManager();
+    if (physics->hasSoftBodies())
+    {
+        CPhysicsManager::SSoftBodyDesc desc;
+        desc.shape = CPhysicsManager::E_SS_CLOTH;
+        desc.points[0] = glm::vec3(-1.0, 1.5, -2.0);
+        desc.points[1] = glm::vec3(1.0, 1.5, -2.0);
+        desc.points[2] = glm::vec3(-1.0, -0.5, -2.0);
+        desc.points[3] = glm::vec3(1.0, -0.5, -2.0);
+        desc.resolution[0] = 32;
+        desc.resolution[1] = 32;
+        desc.pinned = 1 | 2;
+
+        glm::uint32 body = physics->spawnSoft(desc);
+        if (body != CPhysicsManager::INVALID_BODY)
+            addSoftBody(body, "cloth");
+    }
+
+    m_sArena.reset();
+}
+
+void CSecondLife::addSoftBody(glm::uint32 body, char const *name)
+{
+    CPhysicsManager::SSoftTopology const *topology = m_psSystem->getPhysicsManager()->getSoftTopology(body);
+    if (!topology || topology->indices.empty())
+    {
+        fprintf(stderr, "[ERR] Scene Error: Not a soft body.");
+        return;
+    }
+
+    reserveMeshes(1);
+
+    SMeshNode meshNode;
+    meshNode.first = m_vMeshData.size();
+    SMesh mesh;
+    GLuint object = 0;
+
+    //! a position and a normal per node, as getSoftVertices() lays them out
+    GLsizeiptr vertexSize = 2 * topology->nodes * sizeof(glm::vec3);
+
+    GLsizei elementCount = topology->indices.size();
+    GLsizeiptr elementSize = elementCount * sizeof(glm::uint32);
+
+    glGenVertexArrays(1, &object);
+
+    glGenBuffers(SMesh::MAX, &mesh.buffers[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[SMesh::VERTEX]);
+    glBufferData(GL_ARRAY_BUFFER, STREAM_REGIONS * vertexSize, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[SMesh::ELEMENT]);
+    void *elementData = beginUpload(GL_ELEMENT_ARRAY_BUFFER, elementSize);
+    memcpy(elementData, &topology->indices[0], elementSize);
+    endUpload(GL_ELEMENT_ARRAY_BUFFER, elementData, elementSize);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    //! attribute pointers follow the region last streamed into
+    glBindVertexArray(object);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[SMesh::ELEMENT]);
+        glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
+        glEnableVertexAttribArray(helpers::semantic::attr::NORMAL);
+    glBindVertexArray(0);
+
+    addMesh(std::move(mesh), object, topology->lines ? GL_LINES : GL_TRIANGLES, elementCount);
+
+    meshNode.name = name;
+    meshNode.count = 1;
+    meshNode.visible = false;
+    meshNode.transform = m_psSystem->getTransformManager()->create();
+    meshNode.body = body;
+
+    SSoftMesh soft;
+    soft.body = body;
+    soft.mesh = meshNode.first;
+    soft.node = m_sMesh.insert(std::move(meshNode));
+    soft.size = vertexSize;
+    soft.region = 0;
+    for (int r = 0; r < STREAM_REGIONS; r++)
+        soft.fences[r] = 0;
+    soft.step = 0;
+    m_vSoftMesh.push_back(soft);
+}
+
+void CSecondLife::streamSoftBodies()
+{
+    CPhysicsManager *physics = m_psSystem->getPhysicsManager();
+    glm::uint64 step = physics->getStepCount();
+
+    for (size_t i = 0; i < m_vSoftMesh.size(); i++)
+    {
+        SSoftMesh &soft = m_vSoftMesh[i];
+        glm::vec3 const *vertices = physics->getSoftVertices(soft.body);
+        if (!vertices || soft.step == step)
+            continue;
+
+        //! every draw from the region written last has been issued by
+        //! now; the fence marks when the gpu is done with them
+        unsigned int region = 0;
+        if (soft.step != 0)
+        {
+            soft.fences[soft.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (soft.region + 1) % STREAM_REGIONS;
+        }
+
+        if (soft.fences[region])
+        {
+            glClientWaitSync(soft.fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            glDeleteSync(soft.fences[region]);
+            soft.fences[region] = 0;
+        }
+
+        GLintptr offset = region * soft.size;
+        glBindBuffer(GL_ARRAY_BUFFER, m_vMeshData[soft.mesh].buffers[SMesh::VERTEX]);
+        void *data = glMapBufferRange(GL_ARRAY_BUFFER, offset, soft.size,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (data)
+        {
+            memcpy(data, vertices, soft.size);
+            if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE)
+                fprintf(stderr, "[ERR] Scene Error: Buffer contents lost while mapped.");
+        }
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, offset, soft.size, vertices);
+
+        glBindVertexArray(m_sMeshDraw.object[soft.mesh]);
+            glVertexAttribPointer(helpers::semantic::attr::POSITION, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), BUFFER_OFFSET(offset));
+            glVertexAttribPointer(helpers::semantic::attr::NORMAL, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), BUFFER_OFFSET(offset + sizeof(glm::vec3)));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        //! nodes are in world space, the node's transform stays identity
+        size_t nodes = soft.size / (2 * sizeof(glm::vec3));
+        glm::vec3 lower(INFINITY), upper(-INFINITY);
+        for (size_t n = 0; n < nodes; n++)
+        {
+            lower = glm::min(lower, vertices[2 * n]);
+            upper = glm::max(upper, vertices[2 * n]);
+        }
+
+        SMeshNode *node = m_sMesh.get(soft.node);
+        node->bounds.center = (lower + upper) * 0.5f;
+        node->bounds.extent = (upper - lower) * 0.5f;
+        node->visible = true;
+
+        soft.region = region;
+        soft.step = step;
     }
 }
 
@@ -22,6 +22,9 @@
 #include "EmperorSystem.h"
 
 #include "utils/Helpers.h"
+#include "utils/LinearArena.h"
+#include "utils/MathKernels.h"
+#include "utils/SlotMap.h"
 
 class CSecondLife
 {
@@ -34,12 +37,21 @@ public:
     void update();
 
 protected:
-    void loadWaveObjFile(char const *file, char const *path, bool visible, float offset = 0.0);
+    //! collide adds a static triangle mesh body over all of the file's
+    //! shapes, its bvh cached beside the file as <file>.bvh
+    void loadWaveObjFile(char const *file, char const *path, bool visible, float offset = 0.0,
+            bool collide = false);
 
     void push();
     void pop();
 
     void stagePerspectiveObjects();
+    void cullPerspectiveObjects();
+
+    //! a mesh node drawing a soft body from what the physics thread
+    //! publishes, hidden until its first step arrives
+    void addSoftBody(glm::uint32 body, char const *name);
+    void streamSoftBodies();
 
 private:
     CEmperorSystem *m_psSystem;
@@ -131,6 +143,8 @@ private:
         }
     };
 
+    //! cold per mesh data: buffers to free and material state, never
+    //! read while drawing; move-only, it owns its buffers
     struct SMesh
     {
         enum
@@ -141,16 +155,7 @@ private:
             MAX
         };
 
-        GLuint object;
-        std::vector<GLuint> buffers;
-
-        struct
-        {
-            GLuint texture;
-            GLenum type;
-            GLint count;
-        } properties;
-
+        GLuint buffers[MAX];
 
         struct
         {
@@ -170,44 +175,130 @@ private:
 
         struct
         {
-            bool texture;
             bool light;
             bool blend;
             bool cull;
         } options;
 
-        SMesh() : buffers(MAX)
+        SMesh()
         {
-            object = 0;
-            properties.texture = 0;
-            properties.type = 0;
-            properties.count = 0;
+            buffers[VERTEX] = 0;
+            buffers[ELEMENT] = 0;
 
-            options.texture = false;
             options.light = false;
             options.blend = false;
             options.cull = false;
         }
+
+        SMesh(SMesh &&) = default;
+        SMesh& operator=(SMesh &&) = default;
+
+        SMesh(SMesh const &) = delete;
+        SMesh& operator=(SMesh const &) = delete;
     };
 
+    //! hot per mesh data, one array per field indexed like m_vMeshData,
+    //! so the draw loop streams through exactly what it reads
+    struct SMeshDraws
+    {
+        std::vector<GLuint> object;
+        std::vector<GLenum> type;
+        std::vector<GLint> count;
+        std::vector<GLuint> texture;
+    };
+
+    enum
+    {
+        NO_TEXTURE = 0xFFFFFFFF
+    };
+
+    //! a node owns the run [first, first + count) of the mesh arrays and
+    //! is placed by its transform in the transform manager; bounds are in
+    //! node space
     struct SMeshNode
     {
         std::string name;
         bool visible;
         unsigned int priority;
+        glm::uint32 transform;
+        glm::uint32 body;
+        mathkernels::SAABB bounds;
 
-        std::vector<SMesh> mesh;
+        unsigned int first;
+        unsigned int count;
 
         SMeshNode()
         {
             name = "unnamed";
             visible = false;
             priority = 0;
+            transform = CTransformManager::INVALID_HANDLE;
+            body = CPhysicsManager::INVALID_BODY;
+            bounds.center = glm::vec3(0.0);
+            bounds.extent = glm::vec3(0.0);
+            first = 0;
+            count = 0;
         }
+
+        SMeshNode(SMeshNode &&) = default;
+        SMeshNode& operator=(SMeshNode &&) = default;
+
+        SMeshNode(SMeshNode const &) = delete;
+        SMeshNode& operator=(SMeshNode const &) = delete;
     };
 
-    std::map<std::string, SShader> m_mShader;
-    std::vector<SMeshNode> m_vMesh;
+    unsigned int addMesh(SMesh &&mesh, GLuint object, GLenum type, GLint count,
+            GLuint texture = NO_TEXTURE);
+    void reserveMeshes(unsigned int count);
+
+    //! returns where size bytes for the bound buffer should be written:
+    //! the mapped buffer itself, or arena memory when the driver will not
+    //! map; endUpload() unmaps or copies accordingly
+    void *beginUpload(GLenum target, GLsizeiptr size);
+    void endUpload(GLenum target, void *data, GLsizeiptr size);
+
+    CSlotMap<SShader> m_sShader;
+    std::map<std::string, unsigned int> m_mShaderHandle;
+
+    CSlotMap<SMeshNode> m_sMesh;
+    SMeshDraws m_sMeshDraw;
+    std::vector<SMesh> m_vMeshData;
+
+    enum
+    {
+        STREAM_REGIONS = 3
+    };
+
+    //! a soft body's vertex buffer holds STREAM_REGIONS copies of its
+    //! vertices; every new step is written into the next one, unsynchronized
+    //! once the fence behind the frames that drew from it has passed, so
+    //! the buffer is sized once and never orphaned or reallocated
+    struct SSoftMesh
+    {
+        glm::uint32 body;
+        glm::uint32 node;
+        unsigned int mesh;
+
+        GLsizeiptr size;
+        unsigned int region;
+        GLsync fences[STREAM_REGIONS];
+        glm::uint64 step;
+    };
+
+    std::vector<SSoftMesh> m_vSoftMesh;
+
+    //! per frame culling scratch, one entry per mesh node in slot map
+    //! order, kept around so it is only ever resized
+    struct SCulling
+    {
+        std::vector<glm::mat4> world;
+        std::vector<glm::mat4> modelview;
+        std::vector<mathkernels::SAABB> bounds;
+        std::vector<glm::uint8> visible;
+    } m_sCulling;
+
+    //! cpu side scratch for a single load, reset when it finishes
+    CLinearArena m_sArena;
 
     std::stack<glm::mat4, std::vector<glm::mat4> > m_vStack;
     glm::mat4 m_sCurrentMatrix;
@@ -0,0 +1,293 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "AtlasManager.h"
+
+CAtlasManager::CAtlasManager()
+    : m_nPageSize(2048),
+    m_nPadding(2),
+    m_nMipLevels(0)
+{
+}
+
+CAtlasManager::~CAtlasManager()
+{
+}
+
+void CAtlasManager::init(int pageSize, int padding, int mipLevels)
+{
+    m_nPageSize = pageSize;
+    m_nPadding = padding;
+    m_nMipLevels = mipLevels;
+}
+
+void CAtlasManager::destroy()
+{
+    std::vector<SPage>::iterator i = m_vPage.begin();
+    for (; i != m_vPage.end(); i++)
+        glDeleteTextures(1, &i->texture);
+
+    m_vPage.clear();
+    m_vRegion.clear();
+}
+
+unsigned int CAtlasManager::add(char const *file)
+{
+    FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(file, 0);
+    if (fif == FIF_UNKNOWN)
+        fif = FreeImage_GetFIFFromFilename(file);
+
+    if (fif == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(fif))
+        return INVALID_HANDLE;
+
+    FIBITMAP *dib = FreeImage_Load(fif, file);
+    if (!dib)
+        return INVALID_HANDLE;
+
+    FIBITMAP *converted = FreeImage_ConvertTo32Bits(dib);
+    FreeImage_Unload(dib);
+    if (!converted)
+        return INVALID_HANDLE;
+
+    CTextureManager::SImagePayload payload;
+    payload.pixels = FreeImage_GetBits(converted);
+    payload.width = FreeImage_GetWidth(converted);
+    payload.height = FreeImage_GetHeight(converted);
+    payload.format = GL_BGRA;
+
+    unsigned int handle = add(payload);
+    FreeImage_Unload(converted);
+
+    return handle;
+}
+
+unsigned int CAtlasManager::add(CTextureManager::SImagePayload const &payload)
+{
+    int components = 4;
+    switch (payload.format)
+    {
+        case GL_RED:
+            components = 1;
+            break;
+        case GL_RG:
+            components = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+            components = 3;
+            break;
+    }
+
+    int width = payload.width;
+    int height = payload.height;
+
+    //! anything past half a page is not a small image and packs badly
+    if (!payload.pixels || width <= 0 || height <= 0 ||
+            width > m_nPageSize / 2 || height > m_nPageSize / 2)
+        return INVALID_HANDLE;
+
+    //! blocks are aligned to the footprint of one texel at the last mip
+    //! level so neighbours never blend together when minified
+    int alignment = 1 << m_nMipLevels;
+    int blockWidth = (width + 2 * m_nPadding + alignment - 1) & ~(alignment - 1);
+    int blockHeight = (height + 2 * m_nPadding + alignment - 1) & ~(alignment - 1);
+
+    int x = 0, y = 0;
+    unsigned int page = 0;
+    for (; page < m_vPage.size(); page++)
+        if (pack(m_vPage[page], blockWidth, blockHeight, x, y))
+            break;
+
+    if (page == m_vPage.size())
+    {
+        addPage();
+        if (!pack(m_vPage[page], blockWidth, blockHeight, x, y))
+            return INVALID_HANDLE;
+    }
+
+    //! replicate edge texels across the whole block so filtering and mip
+    //! generation only ever see this image's own colours
+    unsigned char const *source = static_cast<unsigned char const *>(payload.pixels);
+    size_t pitch = (size_t(width) * components + 3) & ~size_t(3);
+
+    std::vector<unsigned char> block(size_t(blockWidth) * blockHeight * components);
+    for (int by = 0; by < blockHeight; by++)
+    {
+        int sy = std::min(std::max(by - m_nPadding, 0), height - 1);
+        unsigned char const *row = source + sy * pitch;
+        unsigned char *target = &block[size_t(by) * blockWidth * components];
+
+        for (int bx = 0; bx < blockWidth; bx++)
+        {
+            int sx = std::min(std::max(bx - m_nPadding, 0), width - 1);
+            memcpy(target + bx * components, row + sx * components, components);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_vPage[page].texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, blockWidth, blockHeight,
+            payload.format, GL_UNSIGNED_BYTE, &block[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    m_vPage[page].dirty = true;
+
+    float size = float(m_nPageSize);
+
+    SAtlasRegion region;
+    region.page = page;
+    region.UL = glm::vec2((x + m_nPadding) / size, (y + m_nPadding) / size);
+    region.LR = glm::vec2((x + m_nPadding + width) / size, (y + m_nPadding + height) / size);
+    region.dimension = glm::vec2(width, height);
+    m_vRegion.push_back(region);
+
+    return m_vRegion.size() - 1;
+}
+
+bool CAtlasManager::bindPage(unsigned int page)
+{
+    if (page >= m_vPage.size())
+        return false;
+
+    SPage &p = m_vPage[page];
+    glBindTexture(GL_TEXTURE_2D, p.texture);
+
+    if (p.dirty && m_nMipLevels > 0)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    p.dirty = false;
+
+    return true;
+}
+
+bool CAtlasManager::pack(SPage &page, int width, int height, int &x, int &y)
+{
+    //! skyline bottom-left: take the position with the lowest top edge,
+    //! ties go to the narrowest segment to keep the skyline flat
+    std::vector<SSkylineNode> &skyline = page.skyline;
+
+    size_t best = skyline.size();
+    int bestTop = m_nPageSize + 1;
+    int bestWidth = m_nPageSize + 1;
+
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        int top = fit(page, i, width, height);
+        if (top < 0)
+            continue;
+
+        if (top + height < bestTop || (top + height == bestTop && skyline[i].width < bestWidth))
+        {
+            best = i;
+            bestTop = top + height;
+            bestWidth = skyline[i].width;
+        }
+    }
+
+    if (best == skyline.size())
+        return false;
+
+    x = skyline[best].x;
+    y = bestTop - height;
+
+    SSkylineNode node;
+    node.x = x;
+    node.y = bestTop;
+    node.width = width;
+    skyline.insert(skyline.begin() + best, node);
+
+    //! trim the segments now hidden under the new one
+    for (size_t i = best + 1; i < skyline.size(); i++)
+    {
+        int edge = skyline[i - 1].x + skyline[i - 1].width;
+        if (skyline[i].x >= edge)
+            break;
+
+        int shrink = edge - skyline[i].x;
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+
+        if (skyline[i].width > 0)
+            break;
+
+        skyline.erase(skyline.begin() + i);
+        i--;
+    }
+
+    for (size_t i = 0; i + 1 < skyline.size(); i++)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+            i--;
+        }
+    }
+
+    return true;
+}
+
+int CAtlasManager::fit(SPage const &page, size_t index, int width, int height) const
+{
+    std::vector<SSkylineNode> const &skyline = page.skyline;
+
+    if (skyline[index].x + width > m_nPageSize)
+        return -1;
+
+    int y = skyline[index].y;
+    int remaining = width;
+    for (size_t i = index; remaining > 0 && i < skyline.size(); i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if (y + height > m_nPageSize)
+            return -1;
+
+        remaining -= skyline[i].width;
+    }
+
+    return y;
+}
+
+void CAtlasManager::addPage()
+{
+    SPage page;
+    page.dirty = false;
+
+    SSkylineNode root;
+    root.x = 0;
+    root.y = 0;
+    root.width = m_nPageSize;
+    page.skyline.push_back(root);
+
+    glGenTextures(1, &page.texture);
+    glBindTexture(GL_TEXTURE_2D, page.texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (m_nMipLevels > 0)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_nMipLevels);
+    }
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_nPageSize, m_nPageSize, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    m_vPage.push_back(page);
+}
@@ -0,0 +1,87 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef ATLASMANAGER_H
+#define ATLASMANAGER_H
+
+#include "../Commons.h"
+
+#include "TextureManager.h"
+
+class CAtlasManager
+{
+public:
+    explicit CAtlasManager();
+    ~CAtlasManager();
+
+    static const unsigned int INVALID_HANDLE = 0xFFFFFFFF;
+
+    struct SAtlasRegion
+    {
+        unsigned int page;
+
+        glm::vec2 UL;
+        glm::vec2 LR;
+
+        glm::vec2 dimension;
+    };
+
+    //! padding is the texel gap kept around every image; with mip levels
+    //! above zero the padding is filled with replicated edge texels and
+    //! images are aligned so they never share a texel at the last level
+    void init(int pageSize = 2048, int padding = 2, int mipLevels = 0);
+    void destroy();
+
+    unsigned int add(char const *file);
+    unsigned int add(CTextureManager::SImagePayload const &payload);
+
+    SAtlasRegion const &getRegion(unsigned int handle) const { return m_vRegion[handle]; }
+    unsigned int getRegionCount() const { return m_vRegion.size(); }
+    unsigned int getPageCount() const { return m_vPage.size(); }
+    int getPageSize() const { return m_nPageSize; }
+
+    bool bindPage(unsigned int page);
+
+private:
+    struct SSkylineNode
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    struct SPage
+    {
+        GLuint texture;
+        bool dirty;
+
+        std::vector<SSkylineNode> skyline;
+    };
+
+    bool pack(SPage &page, int width, int height, int &x, int &y);
+    int fit(SPage const &page, size_t index, int width, int height) const;
+    void addPage();
+
+    std::vector<SPage> m_vPage;
+    std::vector<SAtlasRegion> m_vRegion;
+
+    int m_nPageSize;
+    int m_nPadding;
+    int m_nMipLevels;
+};
+
+#endif /* end of include guard: ATLASMANAGER_H */
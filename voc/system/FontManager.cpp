@@ -21,6 +21,16 @@ CFontManager::CFontManager()
     : m_vBuffer(MAX),
     m_vSize(MAX)
 {
+    m_sAtlas.texture = 0;
+    m_sAtlas.width = 1024;
+    m_sAtlas.height = 1024;
+    m_sAtlas.x = 0;
+    m_sAtlas.y = 0;
+    m_sAtlas.row = 0;
+
+    m_sFont.library = nullptr;
+    m_sFont.face = CSlotMap<SFace>::INVALID_HANDLE;
+    m_sFont.size = 0;
 }
 
 CFontManager::~CFontManager()
@@ -33,138 +43,339 @@ void CFontManager::init()
         fprintf(stderr, "[ERR] FontManager Error: An error occured while initializing.");
 
     glGenBuffers(MAX, &m_vBuffer[0]);
+
+    glGenTextures(1, &m_sAtlas.texture);
+    glBindTexture(GL_TEXTURE_2D, m_sAtlas.texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    resetAtlas();
 }
 
 void CFontManager::destroy()
 {
-     std::map<std::string, FT_Face>::iterator i = m_sFont.mface.begin();
+    SFace *i = m_sFont.faces.begin();
 
-    for (; i != m_sFont.mface.end(); i++)
-        FT_Done_Face(i->second);
+    for (; i != m_sFont.faces.end(); i++)
+        FT_Done_Face(i->face);
+    m_sFont.faces.clear();
     m_sFont.mface.clear();
+    m_sFont.fallback.clear();
+
+    m_sGlyphCache.clear();
+    m_sCodepointCache.clear();
 
     FT_Done_FreeType(m_sFont.library);
     glDeleteBuffers(MAX, &m_vBuffer[0]);
+    glDeleteTextures(1, &m_sAtlas.texture);
 }
 
 void CFontManager::load(char const *name, char const *file)
 {
-    FT_Face face;
+    SFace face;
 
     int error = -1;
-    error = FT_New_Face(m_sFont.library, file, 0, &face);
+    error = FT_New_Face(m_sFont.library, file, 0, &face.face);
 
-    if (error == FT_Err_Unknown_File_Format)
+    if (error)
+    {
         fprintf(stderr, "[ERR] FontManager Error: An error occured while loading the font.");
+        return;
+    }
 
-    m_sFont.mface[name] = face;
+    if (m_sFont.mface.find(name) != m_sFont.mface.end())
+    {
+        SFace *existing = m_sFont.faces.get(m_sFont.mface[name]);
+        FT_Done_Face(existing->face);
+        *existing = face;
+    }
+    else
+    {
+        m_sFont.mface[name] = m_sFont.faces.insert(face);
+    }
+
+    m_sGlyphCache.clear();
+    m_sCodepointCache.clear();
+    resetAtlas();
 }
 
 void CFontManager::write(char const *text, glm::vec2 pos)
 {
-    GLuint texture;
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &texture);
+    if (text == NULL || !m_sFont.faces.contains(m_sFont.face))
+        return;
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBlendColor(1.0, 1.0, 1.0, 1.0);
+    m_vVertex.clear();
 
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glm::uint64 previous = ~glm::uint64(0);
+    char const *p = text;
+    while (*p)
+    {
+        glm::uint64 resolved = resolveCodepoint(helpers::decodeUTF8(p));
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        unsigned int handle = resolved >> 32;
+        glm::uint32 index = resolved & 0xFFFFFFFF;
 
-    FT_GlyphSlot glyph = m_sFont.face->glyph;
+        //! kerning is only defined between glyphs of the same face
+        if ((previous >> 32) == handle)
+            pos.x += getKerning(handle, previous & 0xFFFFFFFF, index);
+        previous = resolved;
 
-    char const *p;
-    for (p = text; *p; p++)
-    {
-        if (FT_Load_Char(m_sFont.face, *p, FT_LOAD_RENDER | FT_LOAD_NO_HINTING))
+        SGlyph const *glyph = getGlyph(handle, index);
+        if (!glyph)
             continue;
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, glyph->bitmap.width,
-                glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE,
-                glyph->bitmap.buffer);
+        float w = glyph->dimension.x;
+        float h = glyph->dimension.y;
 
-        int w = glyph->bitmap.width;
-        int h = glyph->bitmap.rows;
+        if (w > 0 && h > 0)
+        {
+            glm::vec2 lpos;
+            lpos.x = pos.x + glyph->bearing.x;
+            lpos.y = (pos.y * -1.0) + glyph->bearing.y;
+
+            m_vVertex.push_back(helpers::SVertv2v2(glm::vec2(lpos.x, lpos.y), glm::vec2(glyph->UL.x, glyph->UL.y)));
+            m_vVertex.push_back(helpers::SVertv2v2(glm::vec2(lpos.x, lpos.y - h), glm::vec2(glyph->UL.x, glyph->LR.y)));
+            m_vVertex.push_back(helpers::SVertv2v2(glm::vec2(lpos.x + w, lpos.y - h), glm::vec2(glyph->LR.x, glyph->LR.y)));
+            m_vVertex.push_back(helpers::SVertv2v2(glm::vec2(lpos.x + w, lpos.y), glm::vec2(glyph->LR.x, glyph->UL.y)));
+        }
 
-        glm::vec2 lpos;
-        lpos.x = pos.x + glyph->bitmap_left;
-        lpos.y = (pos.y * -1.0) + glyph->bitmap_top;
+        pos.x += glyph->advance.x;
+        pos.y += glyph->advance.y;
+    }
 
-        helpers::SVertv2v2 vertexData[4] = 
-        {
-            helpers::SVertv2v2(glm::vec2(lpos.x, lpos.y), glm::vec2(0, 0)),
-            helpers::SVertv2v2(glm::vec2(lpos.x, lpos.y - h), glm::vec2(0, 1)),
-            helpers::SVertv2v2(glm::vec2(lpos.x + w, lpos.y - h), glm::vec2(1, 1)),
-            helpers::SVertv2v2(glm::vec2(lpos.x + w, lpos.y), glm::vec2(1, 0))
-        };
+    flush();
+}
 
-        GLsizei const vertexCount = 4;
-        GLsizeiptr const vertexSize = vertexCount * sizeof(helpers::SVertv2v2);
+void CFontManager::setPixelSize(GLint location, int size)
+{
+    m_sFont.size = size;
 
-        GLsizei const elementCount = 4;
-        GLsizeiptr const elementSize = elementCount * sizeof(glm::uint32);
-        glm::uint32 elementData[] = { 0, 1, 2, 3 };
+    glUniform1f(location, float(m_sFont.size));
+}
 
-        glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
-        if (vertexSize != m_vSize[VERTEX])
-        {
-            glBufferData(GL_ARRAY_BUFFER, vertexSize, vertexData, GL_DYNAMIC_DRAW);
-            m_vSize[VERTEX] = vertexSize;
-        }
-        else
-            glBufferSubData(GL_ARRAY_BUFFER, 0, vertexSize, vertexData);
+void CFontManager::setFontType(char const *name)
+{
+    std::map<std::string, unsigned int>::iterator i = m_sFont.mface.find(name);
+    if (i != m_sFont.mface.end() && i->second != m_sFont.face)
+    {
+        m_sFont.face = i->second;
+        m_sCodepointCache.clear();
+    }
+}
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+void CFontManager::addFallbackFont(char const *name)
+{
+    std::map<std::string, unsigned int>::iterator i = m_sFont.mface.find(name);
+    if (i != m_sFont.mface.end())
+    {
+        m_sFont.fallback.push_back(i->second);
+        m_sCodepointCache.clear();
+    }
+}
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
-        if (elementSize != m_vSize[ELEMENT])
+void CFontManager::clearFallbackFonts()
+{
+    m_sFont.fallback.clear();
+    m_sCodepointCache.clear();
+}
+
+glm::uint64 CFontManager::resolveCodepoint(glm::uint32 codepoint)
+{
+    glm::uint64 const *cached = m_sCodepointCache.find(codepoint);
+    if (cached)
+        return *cached;
+
+    //! the primary face wins, then each fallback in order; if nobody maps
+    //! the codepoint the primary face's missing glyph (index 0) is used
+    glm::uint64 resolved = glm::uint64(m_sFont.face) << 32;
+
+    FT_UInt index = FT_Get_Char_Index(m_sFont.faces.get(m_sFont.face)->face, codepoint);
+    if (index)
+        resolved |= index;
+    else
+    {
+        std::vector<unsigned int>::const_iterator i = m_sFont.fallback.begin();
+        for (; i != m_sFont.fallback.end(); i++)
         {
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, elementData, GL_DYNAMIC_DRAW);
-            m_vSize[ELEMENT] = elementSize;
+            index = FT_Get_Char_Index(m_sFont.faces.get(*i)->face, codepoint);
+            if (index)
+            {
+                resolved = (glm::uint64(*i) << 32) | index;
+                break;
+            }
         }
-        else
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, elementSize, elementData);
+    }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    m_sCodepointCache.insert(codepoint, resolved);
+    return resolved;
+}
 
-        glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
-        glVertexAttribPointer(helpers::semantic::attr::POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(0));
-        glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(sizeof(glm::vec2)));
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+CFontManager::SGlyph const *CFontManager::getGlyph(unsigned int handle, glm::uint32 index)
+{
+    //! TrueType and CFF glyph indices are 16 bit, which leaves the high
+    //! word for the whole face handle
+    glm::uint64 key = (glm::uint64(handle) << 32) | (glm::uint64(m_sFont.size & 0xFFFF) << 16) | (index & 0xFFFF);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
-        glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
-        glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
-            glDrawElements(GL_TRIANGLE_FAN, elementCount, GL_UNSIGNED_INT, 0);
-        glDisableVertexAttribArray(helpers::semantic::attr::POSITION);
-        glDisableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    SGlyph const *cached = m_sGlyphCache.find(key);
+    if (cached)
+        return cached;
+
+    useFaceSize(handle);
+
+    FT_Face face = m_sFont.faces.get(handle)->face;
+    if (FT_Load_Glyph(face, index, FT_LOAD_RENDER | FT_LOAD_NO_HINTING))
+        return nullptr;
+
+    FT_GlyphSlot glyph = face->glyph;
+    int w = glyph->bitmap.width;
+    int h = glyph->bitmap.rows;
+
+    //! one texel of padding keeps linear filtering from bleeding neighbours
+    int const padding = 1;
+    if (m_sAtlas.x + w + padding > m_sAtlas.width)
+    {
+        m_sAtlas.x = 0;
+        m_sAtlas.y += m_sAtlas.row + padding;
+        m_sAtlas.row = 0;
+    }
 
-        pos.x += (glyph->advance.x >> 6);
-        pos.y += (glyph->advance.y >> 6);
+    if (m_sAtlas.y + h + padding > m_sAtlas.height)
+    {
+        //! atlas is full, draw what is pending against the old contents
+        //! and start over with an empty page
+        flush();
+        m_vVertex.clear();
+        m_sGlyphCache.clear();
+        resetAtlas();
     }
 
-    glDisable(GL_BLEND);
-    glDeleteTextures(1, &texture);
+    SGlyph entry;
+    entry.dimension = glm::vec2(w, h);
+    entry.bearing = glm::vec2(glyph->bitmap_left, glyph->bitmap_top);
+    entry.advance = glm::vec2(glyph->advance.x >> 6, glyph->advance.y >> 6);
+
+    if (w > 0 && h > 0)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_sAtlas.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, glyph->bitmap.pitch);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, m_sAtlas.x, m_sAtlas.y, w, h,
+                GL_RED, GL_UNSIGNED_BYTE, glyph->bitmap.buffer);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+        entry.UL = glm::vec2(float(m_sAtlas.x) / m_sAtlas.width, float(m_sAtlas.y) / m_sAtlas.height);
+        entry.LR = glm::vec2(float(m_sAtlas.x + w) / m_sAtlas.width, float(m_sAtlas.y + h) / m_sAtlas.height);
+
+        m_sAtlas.x += w + padding;
+        m_sAtlas.row = std::max(m_sAtlas.row, h);
+    }
+
+    m_sGlyphCache.insert(key, entry);
+    return m_sGlyphCache.find(key);
 }
 
-void CFontManager::setPixelSize(GLint location, int size)
+int CFontManager::getKerning(unsigned int handle, glm::uint32 left, glm::uint32 right)
 {
-    FT_Set_Pixel_Sizes(m_sFont.face, 0, size);
-    m_sFont.size = size;
+    SFace &face = *m_sFont.faces.get(handle);
+    if (!FT_HAS_KERNING(face.face))
+        return 0;
 
-    glUniform1f(location, float(m_sFont.size));
+    useFaceSize(handle);
+
+    glm::uint64 key = (glm::uint64(left) << 32) | right;
+    glm::int16 const *cached = face.kerning.find(key);
+    if (cached)
+        return *cached;
+
+    FT_Vector delta;
+    delta.x = 0;
+    FT_Get_Kerning(face.face, left, right, FT_KERNING_DEFAULT, &delta);
+
+    glm::int16 value = glm::int16(delta.x >> 6);
+    face.kerning.insert(key, value);
+    return value;
 }
 
-void CFontManager::setFontType(char const *name)
+void CFontManager::useFaceSize(unsigned int handle)
 {
-    if (m_sFont.mface.find(name) != m_sFont.mface.end())
-        m_sFont.face = m_sFont.mface[name];
+    SFace &face = *m_sFont.faces.get(handle);
+    if (face.size != m_sFont.size)
+    {
+        FT_Set_Pixel_Sizes(face.face, 0, m_sFont.size);
+        face.size = m_sFont.size;
+        face.kerning.clear();
+    }
+}
+
+void CFontManager::resetAtlas()
+{
+    std::vector<unsigned char> blank(m_sAtlas.width * m_sAtlas.height, 0);
+
+    glBindTexture(GL_TEXTURE_2D, m_sAtlas.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_sAtlas.width, m_sAtlas.height,
+            0, GL_RED, GL_UNSIGNED_BYTE, &blank[0]);
+
+    m_sAtlas.x = 0;
+    m_sAtlas.y = 0;
+    m_sAtlas.row = 0;
+}
+
+void CFontManager::flush()
+{
+    if (m_vVertex.empty())
+        return;
+
+    size_t quadCount = m_vVertex.size() / 4;
+    if (m_vElement.size() < quadCount * 6)
+    {
+        m_vElement.clear();
+        m_vElement.reserve(quadCount * 6);
+        for (size_t q = 0; q < quadCount; q++)
+        {
+            glm::uint32 base = q * 4;
+            glm::uint32 quad[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            m_vElement.insert(m_vElement.end(), quad, quad + 6);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_vElement.size() * sizeof(glm::uint32), &m_vElement[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    GLsizeiptr const vertexSize = m_vVertex.size() * sizeof(helpers::SVertv2v2);
+    GLsizei const elementCount = quadCount * 6;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
+    if (size_t(vertexSize) > m_vSize[VERTEX])
+    {
+        glBufferData(GL_ARRAY_BUFFER, vertexSize, &m_vVertex[0], GL_DYNAMIC_DRAW);
+        m_vSize[VERTEX] = vertexSize;
+    }
+    else
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertexSize, &m_vVertex[0]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_sAtlas.texture);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBlendColor(1.0, 1.0, 1.0, 1.0);
+
+    glVertexAttribPointer(helpers::semantic::attr::POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(0));
+    glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(sizeof(glm::vec2)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
+    glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
+    glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
+        glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0);
+    glDisableVertexAttribArray(helpers::semantic::attr::POSITION);
+    glDisableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glDisable(GL_BLEND);
 }
@@ -20,6 +20,7 @@
 
 #include "../Commons.h"
 #include "../utils/Helpers.h"
+#include "../utils/SlotMap.h"
 
 class CFontManager
 {
@@ -36,9 +37,109 @@ public:
     void setPixelSize(GLint location, int size);
     void setFontType(char const *name);
 
+    void addFallbackFont(char const *name);
+    void clearFallbackFonts();
+
     int getPixelSize() const { return m_sFont.size; }
 
 private:
+    //! open addressed table with linear probing over 64-bit keys, ~0 marks
+    //! an empty slot; used for kerning pairs and glyph lookups so neither
+    //! goes back to FreeType once it is warm
+    template <typename T>
+    struct SPackedHash
+    {
+        std::vector<glm::uint64> keys;
+        std::vector<T> values;
+        size_t count;
+
+        SPackedHash() : keys(64, ~glm::uint64(0)), values(64), count(0) {}
+
+        static size_t mix(glm::uint64 key)
+        {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return size_t(key);
+        }
+
+        T const *find(glm::uint64 key) const
+        {
+            size_t mask = keys.size() - 1;
+            for (size_t i = mix(key) & mask; keys[i] != ~glm::uint64(0); i = (i + 1) & mask)
+                if (keys[i] == key)
+                    return &values[i];
+
+            return nullptr;
+        }
+
+        void insert(glm::uint64 key, T const &value)
+        {
+            if ((count + 1) * 4 > keys.size() * 3)
+            {
+                std::vector<glm::uint64> k(keys.size() * 2, ~glm::uint64(0));
+                std::vector<T> v(values.size() * 2);
+                k.swap(keys);
+                v.swap(values);
+
+                count = 0;
+                for (size_t i = 0; i < k.size(); i++)
+                    if (k[i] != ~glm::uint64(0))
+                        insert(k[i], v[i]);
+            }
+
+            size_t mask = keys.size() - 1;
+            size_t i = mix(key) & mask;
+            for (; keys[i] != ~glm::uint64(0); i = (i + 1) & mask)
+            {
+                if (keys[i] == key)
+                {
+                    values[i] = value;
+                    return;
+                }
+            }
+
+            keys[i] = key;
+            values[i] = value;
+            count++;
+        }
+
+        void clear()
+        {
+            std::fill(keys.begin(), keys.end(), ~glm::uint64(0));
+            count = 0;
+        }
+    };
+
+    struct SGlyph
+    {
+        glm::vec2 UL;
+        glm::vec2 LR;
+
+        glm::vec2 dimension;
+        glm::vec2 bearing;
+        glm::vec2 advance;
+    };
+
+    struct SFace
+    {
+        FT_Face face;
+        int size;
+
+        //! keyed by (left glyph, right glyph) at the current size
+        SPackedHash<glm::int16> kerning;
+
+        SFace() : face(nullptr), size(0) {}
+    };
+
+    SGlyph const *getGlyph(unsigned int handle, glm::uint32 index);
+    glm::uint64 resolveCodepoint(glm::uint32 codepoint);
+    int getKerning(unsigned int handle, glm::uint32 left, glm::uint32 right);
+
+    void useFaceSize(unsigned int handle);
+    void resetAtlas();
+    void flush();
+
     enum
     {
         VERTEX,
@@ -50,13 +151,37 @@ private:
     std::vector<GLuint> m_vBuffer;
     std::vector<size_t> m_vSize;
 
+    std::vector<helpers::SVertv2v2> m_vVertex;
+    std::vector<glm::uint32> m_vElement;
+
+    struct
+    {
+        GLuint texture;
+
+        int width;
+        int height;
+
+        //! shelf packer cursor
+        int x;
+        int y;
+        int row;
+    } m_sAtlas;
+
+    //! keyed by (face handle, pixel size, glyph index)
+    SPackedHash<SGlyph> m_sGlyphCache;
+
+    //! codepoint to (face handle, glyph index) through the fallback chain
+    SPackedHash<glm::uint64> m_sCodepointCache;
+
     struct 
     {
         FT_Library library;
-        FT_Face face;
+        unsigned int face;
 
         int size;
-        std::map<std::string, FT_Face> mface;
+        std::map<std::string, unsigned int> mface;
+        CSlotMap<SFace> faces;
+        std::vector<unsigned int> fallback;
     } m_sFont;
 };
 
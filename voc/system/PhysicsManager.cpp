@@ -17,40 +17,2053 @@
 
 #include "PhysicsManager.h"
 
+namespace
+{
+    inline glm::vec3 toGlm(btVector3 const &v)
+    {
+        return glm::vec3(v.x(), v.y(), v.z());
+    }
+
+    inline glm::quat toGlm(btQuaternion const &q)
+    {
+        return glm::quat(q.w(), q.x(), q.y(), q.z());
+    }
+
+    inline btVector3 toBullet(glm::vec3 const &v)
+    {
+        return btVector3(v.x, v.y, v.z);
+    }
+
+    inline btQuaternion toBullet(glm::quat const &q)
+    {
+        return btQuaternion(q.x, q.y, q.z, q.w);
+    }
+
+    glm::vec3 parseVec3(char const *text, glm::vec3 const &fallback)
+    {
+        glm::vec3 v;
+        if (sscanf(text, "%f %f %f", &v.x, &v.y, &v.z) != 3)
+            return fallback;
+
+        return v;
+    }
+
+    //! fnv-1a over the triangles a bvh cache was built from
+    glm::uint64 hashBytes(void const *data, size_t size, glm::uint64 hash = 14695981039346656037ULL)
+    {
+        glm::uint8 const *bytes = static_cast<glm::uint8 const *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    inline glm::uint32 toBody(btCollisionObject const *object)
+    {
+        return glm::uint32(object->getUserIndex());
+    }
+
+    btCollisionShape *createShape(CPhysicsManager::SBodyDesc const &desc)
+    {
+        if (desc.shape == CPhysicsManager::E_PS_SPHERE)
+            return new btSphereShape(desc.size.x);
+        if (desc.shape == CPhysicsManager::E_PS_CAPSULE)
+            return new btCapsuleShape(desc.size.x, desc.size.y);
+        if (desc.shape == CPhysicsManager::E_PS_PLANE)
+            return new btStaticPlaneShape(toBullet(desc.size), 0.0);
+
+        return new btBoxShape(toBullet(desc.size));
+    }
+
+    //! bodies, not triggers or foreign objects
+    inline bool isBody(btCollisionObject const *object)
+    {
+        return toBody(object) != CPhysicsManager::INVALID_BODY && !btGhostObject::upcast(object);
+    }
+
+    //! caller owned stack, so any number of threads can walk one tree
+    template <typename Visit>
+    void gatherSegment(btCollisionWorld const *world, btBroadphaseInterface *broadphase,
+            btVector3 const &from, btVector3 const &to, btVector3 const &extent,
+            btAlignedObjectArray<btDbvtNode const *> &stack, Visit &visit)
+    {
+        struct SPolicy : btDbvt::ICollide
+        {
+            Visit &visit;
+
+            SPolicy(Visit &v) : visit(v) {}
+
+            void Process(btDbvtNode const *leaf)
+            {
+                btBroadphaseProxy *proxy = static_cast<btBroadphaseProxy *>(leaf->data);
+                visit(static_cast<btCollisionObject *>(proxy->m_clientObject));
+            }
+        } policy(visit);
+
+        btVector3 direction = to - from;
+        btScalar length = direction.length();
+        btDbvtBroadphase *dbvt = dynamic_cast<btDbvtBroadphase *>(broadphase);
+
+        if (dbvt && length > SIMD_EPSILON)
+        {
+            direction /= length;
+
+            btVector3 inverse;
+            unsigned int signs[3];
+            for (int i = 0; i < 3; i++)
+            {
+                inverse[i] = (direction[i] == btScalar(0.0)) ? BT_LARGE_FLOAT : btScalar(1.0) / direction[i];
+                signs[i] = inverse[i] < btScalar(0.0);
+            }
+
+            for (int set = 0; set < 2; set++)
+                dbvt->m_sets[set].rayTestInternal(dbvt->m_sets[set].m_root, from, to, inverse,
+                        signs, length, -extent, extent, stack, policy);
+            return;
+        }
+
+        btVector3 lower = from, upper = from;
+        lower.setMin(to);
+        upper.setMax(to);
+        lower -= extent;
+        upper += extent;
+
+        if (dbvt)
+        {
+            btDbvtVolume volume = btDbvtVolume::FromMM(lower, upper);
+            for (int set = 0; set < 2; set++)
+                dbvt->m_sets[set].collideTV(dbvt->m_sets[set].m_root, volume, policy);
+            return;
+        }
+
+        //! any other broadphase: every object, by its aabb
+        btCollisionObjectArray const &objects = world->getCollisionObjectArray();
+        for (int i = 0; i < objects.size(); i++)
+        {
+            btBroadphaseProxy const *proxy = objects[i]->getBroadphaseHandle();
+            if (TestAabbAgainstAabb2(lower, upper, proxy->m_aabbMin, proxy->m_aabbMax))
+                visit(objects[i]);
+        }
+    }
+
+    //! real-time collision detection 5.1.5
+    btVector3 closestOnTriangle(btVector3 const &p, btVector3 const &a, btVector3 const &b, btVector3 const &c)
+    {
+        btVector3 ab = b - a, ac = c - a, ap = p - a;
+        btScalar d1 = ab.dot(ap), d2 = ac.dot(ap);
+        if (d1 <= 0 && d2 <= 0)
+            return a;
+
+        btVector3 bp = p - b;
+        btScalar d3 = ab.dot(bp), d4 = ac.dot(bp);
+        if (d3 >= 0 && d4 <= d3)
+            return b;
+
+        btScalar vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+            return a + ab * (d1 / (d1 - d3));
+
+        btVector3 cp = p - c;
+        btScalar d5 = ab.dot(cp), d6 = ac.dot(cp);
+        if (d6 >= 0 && d5 <= d6)
+            return c;
+
+        btScalar vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+            return a + ac * (d2 / (d2 - d6));
+
+        btScalar va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+        btScalar denom = btScalar(1.0) / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    struct STriangleOverlap : btTriangleCallback
+    {
+        btVector3 center;
+        btScalar radius2;
+        bool hit;
+
+        STriangleOverlap(btVector3 const &c, btScalar r) : center(c), radius2(r * r), hit(false) {}
+
+        void processTriangle(btVector3 *triangle, int, int)
+        {
+            if (!hit)
+                hit = (closestOnTriangle(center, triangle[0], triangle[1], triangle[2]) - center).length2() <= radius2;
+        }
+    };
+
+    bool overlapsSphere(btCollisionObject const *object, btSphereShape const &sphere, btTransform const &at)
+    {
+        btCollisionShape const *shape = object->getCollisionShape();
+        btTransform const &transform = object->getWorldTransform();
+
+        if (shape->isConcave())
+        {
+            btVector3 center = transform.invXform(at.getOrigin());
+            btVector3 extent(sphere.getRadius(), sphere.getRadius(), sphere.getRadius());
+
+            STriangleOverlap callback(center, sphere.getRadius());
+            static_cast<btConcaveShape const *>(shape)->processAllTriangles(&callback,
+                    center - extent, center + extent);
+            return callback.hit;
+        }
+
+        if (!shape->isConvex())
+            return false;
+
+        //! local solvers, nothing shared between threads
+        btVoronoiSimplexSolver simplex;
+        btGjkEpaPenetrationDepthSolver penetration;
+        btGjkPairDetector detector(&sphere, static_cast<btConvexShape const *>(shape), &simplex, &penetration);
+
+        btGjkPairDetector::ClosestPointInput input;
+        input.m_transformA = at;
+        input.m_transformB = transform;
+
+        btPointCollector result;
+        detector.getClosestPoints(input, result, nullptr);
+        return result.m_hasResult && result.m_distance <= btScalar(0.0);
+    }
+}
+
+struct CPhysicsManager::STriggerPairs : btGhostPairCallback
+{
+    CPhysicsManager *manager;
+
+    explicit STriggerPairs(CPhysicsManager *m) : manager(m) {}
+
+    btBroadphasePair *addOverlappingPair(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1)
+    {
+        record(proxy0, proxy1, true);
+        return btGhostPairCallback::addOverlappingPair(proxy0, proxy1);
+    }
+
+    void *removeOverlappingPair(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1, btDispatcher *dispatcher)
+    {
+        record(proxy0, proxy1, false);
+        return btGhostPairCallback::removeOverlappingPair(proxy0, proxy1, dispatcher);
+    }
+
+    //! pairs from the step in progress or the commands before it go to the next step
+    void record(btBroadphaseProxy *proxy0, btBroadphaseProxy *proxy1, bool enter)
+    {
+        btCollisionObject *object0 = static_cast<btCollisionObject *>(proxy0->m_clientObject);
+        btCollisionObject *object1 = static_cast<btCollisionObject *>(proxy1->m_clientObject);
+
+        btGhostObject *trigger = btGhostObject::upcast(object0);
+        btCollisionObject *other = object1;
+        if (!trigger)
+        {
+            trigger = btGhostObject::upcast(object1);
+            other = object0;
+        }
+
+        if (!trigger || btGhostObject::upcast(other) ||
+                toBody(trigger) == INVALID_BODY || toBody(other) == INVALID_BODY)
+            return;
+
+        STriggerEvent event;
+        event.trigger = toBody(trigger);
+        event.body = toBody(other);
+        event.step = manager->m_nStep + 1;
+        event.enter = enter;
+        manager->m_vTriggerPending.push_back(event);
+    }
+};
+
+//! called only for bodies that moved; sleeping ones cost nothing
+struct CPhysicsManager::SBodyMotion : btMotionState
+{
+    CPhysicsManager *manager;
+    glm::uint32 slot;
+    btTransform transform;
+
+    SBodyMotion(CPhysicsManager *m, glm::uint32 s, btTransform const &t) : manager(m), slot(s), transform(t) {}
+
+    void getWorldTransform(btTransform &t) const
+    {
+        t = transform;
+    }
+
+    //! the multithreaded world calls this from several threads, each with its own bodies
+    void setWorldTransform(btTransform const &t)
+    {
+        transform = t;
+        manager->m_vPosition[manager->m_nState][slot] = toGlm(t.getOrigin());
+        manager->m_vRotation[manager->m_nState][slot] = toGlm(t.getRotation());
+        manager->markMoved(slot);
+    }
+};
+
+//! runs soft bodies across cores instead of one after another
+struct CPhysicsManager::SSoftSolver : btDefaultSoftBodySolver
+{
+    std::vector<btBroadphaseProxy *> proxies;
+    std::vector<btSoftBody *> isolated;
+    std::vector<btSoftBody *> shared;
+
+    //! proxies are detached so each body only writes itself, then moved in order
+    void predictMotion(float step)
+    {
+        int count = m_softBodySet.size();
+        proxies.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            proxies[i] = m_softBodySet[i]->getBroadphaseHandle();
+            m_softBodySet[i]->setBroadphaseHandle(nullptr);
+        }
+
+        #pragma omp parallel for schedule(dynamic, 1) if (count > 1)
+        for (int i = 0; i < count; i++)
+        {
+            if (m_softBodySet[i]->isActive())
+                m_softBodySet[i]->predictMotion(step);
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            btSoftBody *soft = m_softBodySet[i];
+            soft->setBroadphaseHandle(proxies[i]);
+            if (proxies[i])
+                soft->getWorldInfo()->m_broadphase->setAabb(proxies[i], soft->m_bounds[0],
+                        soft->m_bounds[1], soft->getWorldInfo()->m_dispatcher);
+        }
+    }
+
+    //! bodies pushing other movable bodies solve one at a time
+    void solveConstraints(float)
+    {
+        isolated.clear();
+        shared.clear();
+        for (int i = 0; i < m_softBodySet.size(); i++)
+        {
+            btSoftBody *soft = m_softBodySet[i];
+            if (soft->isActive())
+                (isIsolated(soft) ? isolated : shared).push_back(soft);
+        }
+
+        int count = int(isolated.size());
+        #pragma omp parallel for schedule(dynamic, 1) if (count > 1)
+        for (int i = 0; i < count; i++)
+            isolated[i]->solveConstraints();
+
+        for (size_t i = 0; i < shared.size(); i++)
+            shared[i]->solveConstraints();
+    }
+
+    static bool isIsolated(btSoftBody const *soft)
+    {
+        if (soft->m_scontacts.size() > 0 || soft->m_joints.size() > 0)
+            return false;
+
+        for (int i = 0; i < soft->m_anchors.size(); i++)
+        {
+            if (soft->m_anchors[i].m_body->getInvMass() != btScalar(0.0))
+                return false;
+        }
+
+        for (int i = 0; i < soft->m_rcontacts.size(); i++)
+        {
+            btRigidBody const *rigid = btRigidBody::upcast(soft->m_rcontacts[i].m_cti.m_colObj);
+            if (rigid && rigid->getInvMass() != btScalar(0.0))
+                return false;
+        }
+
+        return true;
+    }
+};
+
 CPhysicsManager::CPhysicsManager()
     : m_psBroadphase(nullptr),
     m_psCollisionConfiguration(nullptr),
     m_psDispatcher(nullptr),
     m_psSolver(nullptr),
-    m_psWorld(nullptr)
+    m_psSolverPool(nullptr),
+    m_psWorld(nullptr),
+    m_psSoftWorld(nullptr),
+    m_psSoftSolver(nullptr),
+    m_psTriggerPairs(nullptr),
+    m_psScheduler(nullptr),
+    m_nThreads(1),
+    m_bMultithreaded(false),
+    m_bRunning(false),
+    m_psQueryPairs(nullptr),
+    m_psQueryBroadphase(nullptr),
+    m_psQueryDispatcher(nullptr),
+    m_psQueryWorld(nullptr),
+    m_nFrame(0),
+    m_nStamp(1),
+    m_nPublished(1),
+    m_nState(0),
+    m_fStep(1.0f / 60.0f),
+    m_nMaxSubsteps(8),
+    m_nStep(0),
+    m_fLinearSleep(0.8f),
+    m_fAngularSleep(1.0f),
+    m_fSleepTime(2.0f),
+    m_bStats(false),
+    m_nReady(1),
+    m_nBack(0),
+    m_nFront(2),
+    m_bDropped(false),
+    m_fInterpolation(0.0f)
 {
+    m_nMoved[0] = 0;
+    m_nMoved[1] = 0;
 }
 
 CPhysicsManager::~CPhysicsManager()
 {
+    if (m_sThread.joinable())
+    {
+        m_bRunning = false;
+        m_sThread.join();
+    }
 }
 
-void CPhysicsManager::init()
+CPhysicsManager::SConfig CPhysicsManager::loadConfig(char const *file)
 {
-    m_psBroadphase = new btDbvtBroadphase();
-    m_psCollisionConfiguration = new btDefaultCollisionConfiguration();
-    m_psDispatcher = new btCollisionDispatcher(m_psCollisionConfiguration);
-    m_psSolver = new btSequentialImpulseConstraintSolver();
-    m_psWorld = new btDiscreteDynamicsWorld(m_psDispatcher, m_psBroadphase, m_psSolver, m_psCollisionConfiguration);
-    m_psWorld->setGravity(btVector3(0.0, -9.8, 0.0));
+    SConfig config;
+
+    pugi::xml_document doc;
+    if (!doc.load_file(file))
+    {
+        fprintf(stderr, "[ERR] Physics Error: Unable to load %s, using defaults.", file);
+        return config;
+    }
+
+    pugi::xml_node physics = doc.child("config").child("physics");
+    config.multithreaded = physics.attribute("multithreaded").as_bool(config.multithreaded);
+    config.threads = physics.attribute("threads").as_uint(config.threads);
+    config.stats = physics.attribute("stats").as_bool(config.stats);
+    config.softBodies = physics.attribute("softbodies").as_bool(config.softBodies);
+
+    pugi::xml_node broadphase = physics.child("broadphase");
+    if (strcmp(broadphase.attribute("type").value(), "axis-sweep") == 0)
+        config.broadphase = E_PB_AXIS_SWEEP;
+    config.worldMin = parseVec3(broadphase.attribute("min").value(), config.worldMin);
+    config.worldMax = parseVec3(broadphase.attribute("max").value(), config.worldMax);
+    config.maxProxies = broadphase.attribute("proxies").as_uint(config.maxProxies);
+
+    config.iterations = physics.child("solver").attribute("iterations").as_uint(config.iterations);
+
+    pugi::xml_node sleeping = physics.child("sleeping");
+    config.linearSleep = sleeping.attribute("linear").as_float(config.linearSleep);
+    config.angularSleep = sleeping.attribute("angular").as_float(config.angularSleep);
+    config.sleepTime = sleeping.attribute("time").as_float(config.sleepTime);
+
+    config.contactBreaking = physics.child("contacts").attribute("breaking").as_float(config.contactBreaking);
+    config.gravity = parseVec3(physics.child("gravity").attribute("value").value(), config.gravity);
+
+    return config;
+}
+
+void CPhysicsManager::init(SConfig const &config)
+{
+    //! the 16 bit sweep stops at 16384 proxies
+    if (config.broadphase == E_PB_AXIS_SWEEP && config.maxProxies <= 16384)
+        m_psBroadphase = new btAxisSweep3(toBullet(config.worldMin), toBullet(config.worldMax),
+                config.maxProxies);
+    else if (config.broadphase == E_PB_AXIS_SWEEP)
+        m_psBroadphase = new bt32BitAxisSweep3(toBullet(config.worldMin), toBullet(config.worldMax),
+                config.maxProxies);
+    else
+        m_psBroadphase = new btDbvtBroadphase();
+
+    if (config.softBodies)
+        m_psCollisionConfiguration = new btSoftBodyRigidBodyCollisionConfiguration();
+    else
+        m_psCollisionConfiguration = new btDefaultCollisionConfiguration();
+
+    bool multithreaded = config.multithreaded;
+#if !defined(BT_THREADSAFE) || !BT_THREADSAFE
+    if (multithreaded)
+        fprintf(stderr, "[ERR] Physics Error: Built without BT_THREADSAFE (make BULLET_MT=1), using one thread.");
+    multithreaded = false;
+#endif
+
+    if (multithreaded && config.softBodies)
+    {
+        fprintf(stderr, "[ERR] Physics Error: Soft bodies need the single threaded world, using one thread.");
+        multithreaded = false;
+    }
+
+    if (multithreaded)
+    {
+        btITaskScheduler *scheduler = btGetOpenMPTaskScheduler();
+        if (!scheduler)
+            scheduler = m_psScheduler = btCreateDefaultTaskScheduler();
+
+        if (scheduler)
+        {
+            int threads = scheduler->getMaxNumThreads();
+            if (config.threads > 0)
+                threads = std::min(int(config.threads), threads);
+
+            scheduler->setNumThreads(threads);
+            btSetTaskScheduler(scheduler);
+            m_nThreads = scheduler->getNumThreads();
+        }
+        else
+        {
+            fprintf(stderr, "[ERR] Physics Error: No task scheduler available, using one thread.");
+            multithreaded = false;
+        }
+    }
+
+    if (multithreaded)
+    {
+        m_psDispatcher = new btCollisionDispatcherMt(m_psCollisionConfiguration);
+        m_psSolverPool = new btConstraintSolverPoolMt(m_nThreads);
+        m_psSolver = new btSequentialImpulseConstraintSolverMt();
+        m_psWorld = new btDiscreteDynamicsWorldMt(m_psDispatcher, m_psBroadphase, m_psSolverPool,
+                m_psSolver, m_psCollisionConfiguration);
+        m_bMultithreaded = true;
+    }
+    else
+    {
+        m_nThreads = 1;
+        m_bMultithreaded = false;
+        m_psDispatcher = new btCollisionDispatcher(m_psCollisionConfiguration);
+        m_psSolver = new btSequentialImpulseConstraintSolver();
+        if (config.softBodies)
+        {
+            m_psSoftSolver = new SSoftSolver();
+            m_psSoftWorld = new btSoftRigidDynamicsWorld(m_psDispatcher, m_psBroadphase, m_psSolver,
+                    m_psCollisionConfiguration, m_psSoftSolver);
+            m_psWorld = m_psSoftWorld;
+        }
+        else
+            m_psWorld = new btDiscreteDynamicsWorld(m_psDispatcher, m_psBroadphase, m_psSolver,
+                    m_psCollisionConfiguration);
+    }
+
+    //! soft bodies fall by the world info's gravity
+    m_psWorld->setGravity(toBullet(config.gravity));
+    if (m_psSoftWorld)
+        m_psSoftWorld->getWorldInfo().m_gravity = toBullet(config.gravity);
+    m_psWorld->getSolverInfo().m_numIterations = std::max(1u, config.iterations);
+
+    //! a bullet global
+    gContactBreakingThreshold = config.contactBreaking;
+
+    m_fLinearSleep = config.linearSleep;
+    m_fAngularSleep = config.angularSleep;
+    m_fSleepTime = config.sleepTime;
+
+    m_bStats = config.stats;
+
+    m_psTriggerPairs = new STriggerPairs(this);
+    m_psBroadphase->getOverlappingPairCache()->setInternalGhostPairCallback(m_psTriggerPairs);
+
+    //! retire every stale pair each step, trigger exits would lag otherwise
+    btDbvtBroadphase *dbvt = dynamic_cast<btDbvtBroadphase *>(m_psBroadphase);
+    if (dbvt)
+        dbvt->m_cupdates = 100;
+
+    if (!config.manual)
+    {
+        //! null pair cache, deferred collision: the broadphase stays a bare tree
+        m_psQueryPairs = new btNullPairCache();
+        m_psQueryBroadphase = new btDbvtBroadphase(m_psQueryPairs);
+        m_psQueryBroadphase->m_deferedcollide = true;
+        m_psQueryDispatcher = new btCollisionDispatcher(m_psCollisionConfiguration);
+        m_psQueryWorld = new btCollisionWorld(m_psQueryDispatcher, m_psQueryBroadphase,
+                m_psCollisionConfiguration);
+
+        m_bRunning = true;
+        m_sThread = std::thread(&CPhysicsManager::run, this);
+    }
 }
 
 void CPhysicsManager::destroy()
 {
+    if (m_sThread.joinable())
+    {
+        m_bRunning = false;
+        m_sWake.notify_one();
+        m_sThread.join();
+    }
+
+    for (size_t slot = 0; slot < m_vQueryObject.size(); slot++)
+    {
+        if (m_vQueryObject[slot])
+            unmirror(slot);
+    }
+
+    for (size_t slot = 0; slot < m_vBody.size(); slot++)
+    {
+        if (m_vBody[slot])
+            release(m_vBody[slot]);
+        if (m_vTrigger[slot])
+            release(m_vTrigger[slot]);
+        if (m_vSoft[slot])
+            release(m_vSoft[slot]);
+    }
+
+    //! meshes go after the bodies using them, including any still queued
+    for (size_t i = 0; i < m_vMesh.size(); i++)
+        destroyMesh(m_vMesh[i]);
+
+    for (size_t i = 0; i < m_vCommand.size(); i++)
+    {
+        if (m_vCommand[i].type == E_PC_MESH)
+            destroyMesh(m_vCommand[i].mesh);
+        else if (m_vCommand[i].type == E_PC_SOFT)
+            delete m_vCommand[i].soft;
+    }
+
+    m_vBody.clear();
+    m_vTrigger.clear();
+    m_vSoft.clear();
+    m_vSoftTopology.clear();
+    m_vBodyHandle.clear();
+    m_vCommand.clear();
+    m_vTriggerPending.clear();
+    m_vTriggerMailbox.clear();
+    m_vTriggerEvent.clear();
+    m_vBinding.clear();
+    m_vRebound.clear();
+    m_vMovedFrame.clear();
+    m_vMovedPending.clear();
+    m_vMovedStamp.clear();
+    m_vPendingStamp.clear();
+    for (int s = 0; s < 2; s++)
+    {
+        m_vMoved[s].clear();
+        m_nMoved[s] = 0;
+    }
+
+    for (int b = 0; b < 3; b++)
+    {
+        m_sSnapshot[b] = SSnapshot();
+        m_vStale[b].clear();
+        m_vStaleMark[b].clear();
+    }
+    m_nReady = 1;
+    m_nBack = 0;
+    m_nFront = 2;
+    m_bDropped = false;
+    m_vMesh.clear();
+    m_mMeshHandle.clear();
+    m_vQueryObject.clear();
+    m_vQueryMesh.clear();
+    m_vQueryPending.clear();
+
+    delete m_psQueryWorld;
+    delete m_psQueryDispatcher;
+    delete m_psQueryBroadphase;
+    delete m_psQueryPairs;
+    m_psQueryWorld = nullptr;
+    m_psQueryDispatcher = nullptr;
+    m_psQueryBroadphase = nullptr;
+    m_psQueryPairs = nullptr;
+
     delete m_psWorld;
+    delete m_psSoftSolver;
+    delete m_psTriggerPairs;
     delete m_psSolver;
+    delete m_psSolverPool;
     delete m_psDispatcher;
     delete m_psCollisionConfiguration;
     delete m_psBroadphase;
+
+    m_psWorld = nullptr;
+    m_psSoftWorld = nullptr;
+    m_psSoftSolver = nullptr;
+    m_psTriggerPairs = nullptr;
+    m_psSolver = nullptr;
+    m_psSolverPool = nullptr;
+
+    if (m_psScheduler)
+    {
+        btSetTaskScheduler(btGetSequentialTaskScheduler());
+        delete m_psScheduler;
+        m_psScheduler = nullptr;
+    }
+}
+
+void CPhysicsManager::step()
+{
+    if (m_sThread.joinable())
+    {
+        fprintf(stderr, "[ERR] Physics Error: step() is only for manual mode.");
+        return;
+    }
+
+    drain();
+    advance();
+    publish();
 }
 
 void CPhysicsManager::update()
 {
-    m_psWorld->stepSimulation(0, 10);
+    bool fresh = false;
+    if (m_nReady.load() & FRESH)
+    {
+        m_nFront = m_nReady.exchange(m_nFront) & (FRESH - 1);
+        fresh = true;
+    }
+
+    m_vTriggerEvent.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_sMutex);
+        m_vTriggerEvent.swap(m_vTriggerMailbox);
+    }
+
+    //! the frame renders one step behind the simulation
+    SSnapshot const &front = m_sSnapshot[m_nFront];
+    double since = double(SDL_GetPerformanceCounter() - front.counter) / double(SDL_GetPerformanceFrequency());
+    m_fInterpolation = glm::clamp(float(since) / front.stepLength, 0.0f, 1.0f);
+
+    //! moved slots once per snapshot, blending ones every frame, nothing else
+    m_sMoved.transform.clear();
+    m_sMoved.position.clear();
+    m_sMoved.rotation.clear();
+    m_nFrame++;
+
+    if (fresh)
+        bridge(front.moved);
+    bridge(front.moving);
+    bridge(m_vRebound);
+    m_vRebound.clear();
+
+    if (!m_psQueryWorld)
+        return;
+
+    if (fresh)
+        follow(front.moved);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < m_vQueryPending.size(); i++)
+    {
+        glm::uint32 body = m_vQueryPending[i].body;
+        glm::uint32 slot = body & SLOT_MASK;
+        if (m_vGeneration[slot] != (body >> SLOT_BITS) || mirror(m_vQueryPending[i]))
+            continue;
+
+        m_vQueryPending[kept++] = m_vQueryPending[i];
+    }
+    m_vQueryPending.resize(kept);
+}
+
+glm::uint32 CPhysicsManager::spawn(SBodyDesc const &desc)
+{
+    glm::uint32 body = allocate();
+    if (body == INVALID_BODY)
+        return INVALID_BODY;
+
+    SCommand command;
+    command.type = E_PC_SPAWN;
+    command.body = body;
+    command.desc = desc;
+    queue(command);
+
+    if (m_psQueryWorld && !desc.trigger && !mirror(command))
+        m_vQueryPending.push_back(command);
+
+    return body;
+}
+
+glm::uint32 CPhysicsManager::spawnSoft(SSoftBodyDesc const &desc)
+{
+    if (!m_psSoftWorld)
+    {
+        fprintf(stderr, "[ERR] Physics Error: Soft bodies are off in the physics config.");
+        return INVALID_BODY;
+    }
+
+    //! the helpers read only the world info, safe while the world steps
+    btSoftBodyWorldInfo &info = m_psSoftWorld->getWorldInfo();
+    int across = int(std::max(desc.resolution[0], 2u));
+    int down = int(std::max(desc.resolution[1], 2u));
+
+    btSoftBody *soft;
+    if (desc.shape == E_SS_ROPE)
+        soft = btSoftBodyHelpers::CreateRope(info, toBullet(desc.points[0]), toBullet(desc.points[1]),
+                int(std::max(desc.resolution[0], 1u)) - 1, int(desc.pinned & 3));
+    else if (desc.shape == E_SS_BLOB)
+        soft = btSoftBodyHelpers::CreateEllipsoid(info, toBullet(desc.points[0]), toBullet(desc.points[1]),
+                std::max(across, 4));
+    else
+        soft = btSoftBodyHelpers::CreatePatch(info, toBullet(desc.points[0]), toBullet(desc.points[1]),
+                toBullet(desc.points[2]), toBullet(desc.points[3]), across, down, int(desc.pinned & 15), true);
+
+    soft->m_materials[0]->m_kLST = glm::clamp(desc.stiffness, 0.0f, 1.0f);
+    soft->m_cfg.kDF = desc.friction;
+    soft->m_cfg.kPR = desc.pressure;
+    soft->m_cfg.collisions |= btSoftBody::fCollision::VF_SS;
+    if (desc.shape == E_SS_CLOTH)
+        soft->generateBendingConstraints(2, soft->m_materials[0]);
+
+    soft->setTotalMass(desc.mass, false);
+
+    glm::uint32 body = allocate();
+    if (body == INVALID_BODY)
+    {
+        delete soft;
+        return INVALID_BODY;
+    }
+
+    glm::uint32 slot = body & SLOT_MASK;
+    if (slot >= m_vSoftTopology.size())
+        m_vSoftTopology.resize(slot + 1);
+
+    SSoftTopology &topology = m_vSoftTopology[slot];
+    btSoftBody::Node const *first = &soft->m_nodes[0];
+    topology.indices.clear();
+    topology.nodes = soft->m_nodes.size();
+    topology.lines = soft->m_faces.size() == 0;
+    if (topology.lines)
+    {
+        for (int i = 0; i < soft->m_links.size(); i++)
+            for (int n = 0; n < 2; n++)
+                topology.indices.push_back(glm::uint32(soft->m_links[i].m_n[n] - first));
+    }
+    else
+    {
+        for (int i = 0; i < soft->m_faces.size(); i++)
+            for (int n = 0; n < 3; n++)
+                topology.indices.push_back(glm::uint32(soft->m_faces[i].m_n[n] - first));
+    }
+
+    SCommand command;
+    command.type = E_PC_SOFT;
+    command.body = body;
+    command.soft = soft;
+    queue(command);
+
+    return body;
+}
+
+CPhysicsManager::SSoftTopology const *CPhysicsManager::getSoftTopology(glm::uint32 body) const
+{
+    glm::uint32 slot = body & SLOT_MASK;
+    if (slot >= m_vSoftTopology.size() || m_vGeneration[slot] != (body >> SLOT_BITS) ||
+            m_vSoftTopology[slot].nodes == 0)
+        return nullptr;
+
+    return &m_vSoftTopology[slot];
+}
+
+glm::vec3 const *CPhysicsManager::getSoftVertices(glm::uint32 body) const
+{
+    SSnapshot const &front = m_sSnapshot[m_nFront];
+
+    glm::uint32 slot = body & SLOT_MASK;
+    if (slot >= front.softFirst.size() || front.handle[slot] != body ||
+            front.softFirst[slot] == NO_VERTICES)
+        return nullptr;
+
+    return &front.softVertex[front.softFirst[slot]];
+}
+
+void CPhysicsManager::remove(glm::uint32 body)
+{
+    glm::uint32 slot = body & SLOT_MASK;
+    if (slot >= m_vGeneration.size() || m_vGeneration[slot] != (body >> SLOT_BITS))
+        return;
+
+    //! the handle is dead here at once; the removal runs before any reuse of the slot
+    glm::uint32 generation = (m_vGeneration[slot] + 1) & (0xFFFFFFFF >> SLOT_BITS);
+    if (((generation << SLOT_BITS) | slot) == INVALID_BODY)
+        generation = 0;
+
+    m_vGeneration[slot] = generation;
+    m_vFreeSlot.push_back(slot);
+
+    if (slot < m_vBinding.size())
+        m_vBinding[slot] = UNBOUND;
+
+    if (slot < m_vQueryObject.size() && m_vQueryObject[slot])
+        unmirror(slot);
+
+    if (slot < m_vSoftTopology.size())
+    {
+        m_vSoftTopology[slot].indices.clear();
+        m_vSoftTopology[slot].nodes = 0;
+    }
+
+    SCommand command;
+    command.type = E_PC_REMOVE;
+    command.body = body;
+    queue(command);
+}
+
+glm::uint32 CPhysicsManager::createMesh(std::string const &key, std::vector<glm::vec3> &&vertices,
+        std::vector<glm::uint32> &&indices, std::string const &cache)
+{
+    glm::uint32 handle = findMesh(key);
+    if (handle != INVALID_MESH)
+        return handle;
+
+    if (vertices.empty() || indices.empty() || (indices.size() % 3) != 0)
+    {
+        fprintf(stderr, "[ERR] Physics Error: Invalid triangle mesh %s.", key.c_str());
+        return INVALID_MESH;
+    }
+
+    handle = m_mMeshHandle.size();
+    m_mMeshHandle[key] = handle;
+
+    STriangleMesh *mesh = new STriangleMesh();
+    mesh->vertices = std::move(vertices);
+    mesh->indices = std::move(indices);
+    mesh->cache = cache;
+    m_vQueryMesh.push_back(mesh);
+
+    SCommand command;
+    command.type = E_PC_MESH;
+    command.body = handle;
+    command.mesh = mesh;
+    queue(command);
+
+    return handle;
+}
+
+glm::uint32 CPhysicsManager::findMesh(std::string const &key) const
+{
+    std::map<std::string, glm::uint32>::const_iterator it = m_mMeshHandle.find(key);
+    if (it == m_mMeshHandle.end())
+        return INVALID_MESH;
+
+    return it->second;
+}
+
+void CPhysicsManager::raycast(SRay const *rays, SHit *hits, size_t count)
+{
+    btCollisionWorld *world = queryWorld();
+    if (world && count > 0)
+        runRays(world, rays, hits, count);
+}
+
+void CPhysicsManager::sweep(SSweep const *sweeps, SHit *hits, size_t count)
+{
+    btCollisionWorld *world = queryWorld();
+    if (world && count > 0)
+        runSweeps(world, sweeps, hits, count);
+}
+
+void CPhysicsManager::overlap(SSphere const *spheres, glm::uint32 *bodies, glm::uint32 *counts,
+        size_t count, size_t capacity)
+{
+    btCollisionWorld *world = queryWorld();
+    if (world && count > 0)
+        runOverlaps(world, spheres, bodies, counts, count, capacity);
+}
+
+void CPhysicsManager::connect(glm::uint32 a, glm::uint32 b, glm::vec3 const &pivot, glm::vec3 const &axis,
+        float swing, float twist)
+{
+    SCommand command;
+    command.type = E_PC_JOINT;
+    command.body = a;
+    command.other = b;
+    command.vector = pivot;
+    command.axis = glm::normalize(axis);
+    command.swing = swing;
+    command.twist = twist;
+    queue(command);
+}
+
+void CPhysicsManager::applyForce(glm::uint32 body, glm::vec3 const &force)
+{
+    SCommand command;
+    command.type = E_PC_FORCE;
+    command.body = body;
+    command.vector = force;
+    queue(command);
+}
+
+void CPhysicsManager::applyImpulse(glm::uint32 body, glm::vec3 const &impulse)
+{
+    SCommand command;
+    command.type = E_PC_IMPULSE;
+    command.body = body;
+    command.vector = impulse;
+    queue(command);
+}
+
+void CPhysicsManager::setVelocity(glm::uint32 body, glm::vec3 const &velocity)
+{
+    SCommand command;
+    command.type = E_PC_VELOCITY;
+    command.body = body;
+    command.vector = velocity;
+    queue(command);
+}
+
+void CPhysicsManager::setTransform(glm::uint32 body, glm::vec3 const &position, glm::quat const &rotation)
+{
+    SCommand command;
+    command.type = E_PC_TRANSFORM;
+    command.body = body;
+    command.vector = position;
+    command.rotation = rotation;
+    queue(command);
+}
+
+void CPhysicsManager::setGravity(glm::vec3 const &gravity)
+{
+    SCommand command;
+    command.type = E_PC_GRAVITY;
+    command.body = INVALID_BODY;
+    command.vector = gravity;
+    queue(command);
+}
+
+void CPhysicsManager::setFixedTimestep(float step, unsigned int maxSubsteps)
+{
+    if (step <= 0.0f || maxSubsteps == 0)
+    {
+        fprintf(stderr, "[ERR] Physics Error: Invalid fixed timestep.");
+        return;
+    }
+
+    SCommand command;
+    command.type = E_PC_TIMESTEP;
+    command.body = INVALID_BODY;
+    command.step = step;
+    command.maxSubsteps = maxSubsteps;
+    queue(command);
+}
+
+bool CPhysicsManager::getTransform(glm::uint32 body, glm::vec3 &position, glm::quat &rotation) const
+{
+    SSnapshot const &front = m_sSnapshot[m_nFront];
+
+    glm::uint32 slot = body & SLOT_MASK;
+    if (slot >= front.handle.size() || front.handle[slot] != body)
+        return false;
+
+    position = glm::mix(front.position[0][slot], front.position[1][slot], m_fInterpolation);
+    rotation = glm::slerp(front.rotation[0][slot], front.rotation[1][slot], m_fInterpolation);
+    return true;
+}
+
+void CPhysicsManager::bind(glm::uint32 body, glm::uint32 transform)
+{
+    glm::uint32 slot = body & SLOT_MASK;
+    if (slot >= m_vGeneration.size() || m_vGeneration[slot] != (body >> SLOT_BITS))
+        return;
+
+    if (slot >= m_vBinding.size())
+    {
+        m_vBinding.resize(slot + 1, UNBOUND);
+        m_vMovedFrame.resize(slot + 1, 0);
+    }
+
+    m_vBinding[slot] = transform;
+    m_vRebound.push_back(slot);
+}
+
+void CPhysicsManager::bridge(std::vector<glm::uint32> const &slots)
+{
+    SSnapshot const &front = m_sSnapshot[m_nFront];
+
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        glm::uint32 slot = slots[i];
+        if (slot >= m_vBinding.size() || m_vBinding[slot] == UNBOUND || m_vMovedFrame[slot] == m_nFrame)
+            continue;
+
+        //! the slot may have changed hands since the snapshot
+        glm::uint32 body = (m_vGeneration[slot] << SLOT_BITS) | slot;
+        if (slot >= front.handle.size() || front.handle[slot] != body)
+            continue;
+
+        m_vMovedFrame[slot] = m_nFrame;
+        m_sMoved.transform.push_back(m_vBinding[slot]);
+        m_sMoved.position.push_back(glm::mix(front.position[0][slot], front.position[1][slot], m_fInterpolation));
+        m_sMoved.rotation.push_back(glm::slerp(front.rotation[0][slot], front.rotation[1][slot], m_fInterpolation));
+    }
+}
+
+glm::uint32 CPhysicsManager::allocate()
+{
+    glm::uint32 slot;
+    if (!m_vFreeSlot.empty())
+    {
+        slot = m_vFreeSlot.back();
+        m_vFreeSlot.pop_back();
+    }
+    else
+    {
+        slot = m_vGeneration.size();
+        if (slot > SLOT_MASK)
+        {
+            fprintf(stderr, "[ERR] Physics Error: Out of body handles.");
+            return INVALID_BODY;
+        }
+
+        m_vGeneration.push_back(0);
+    }
+
+    return (m_vGeneration[slot] << SLOT_BITS) | slot;
+}
+
+void CPhysicsManager::queue(SCommand const &command)
+{
+    std::lock_guard<std::mutex> lock(m_sMutex);
+    m_vCommand.push_back(command);
+}
+
+btCollisionWorld *CPhysicsManager::queryWorld()
+{
+    if (m_psQueryWorld || !m_psWorld)
+        return m_psQueryWorld;
+
+    //! manual mode has no other thread touching the world
+    drain();
+    return m_psWorld;
+}
+
+bool CPhysicsManager::mirror(SCommand const &spawn)
+{
+    SBodyDesc const &desc = spawn.desc;
+
+    btCollisionShape *shape;
+    if (desc.shape == E_PS_MESH)
+    {
+        //! an unknown mesh is the physics thread's to report
+        if (desc.mesh >= m_vQueryMesh.size())
+            return true;
+        if (!m_vQueryMesh[desc.mesh]->ready)
+            return false;
+
+        shape = m_vQueryMesh[desc.mesh]->shape;
+    }
+    else
+        shape = createShape(desc);
+
+    glm::uint32 slot = spawn.body & SLOT_MASK;
+    if (slot >= m_vQueryObject.size())
+        m_vQueryObject.resize(slot + 1, nullptr);
+
+    //! the mesh body may have moved before its mesh was ready
+    SSnapshot const &front = m_sSnapshot[m_nFront];
+    btTransform transform(toBullet(desc.rotation), toBullet(desc.position));
+    if (slot < front.handle.size() && front.handle[slot] == spawn.body)
+        transform = btTransform(toBullet(front.rotation[1][slot]), toBullet(front.position[1][slot]));
+
+    //! static, so a plane's endless aabb is accepted
+    btCollisionObject *object = new btCollisionObject();
+    object->setCollisionShape(shape);
+    object->setWorldTransform(transform);
+    object->setCollisionFlags(object->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+    object->setUserIndex(int(spawn.body));
+    m_psQueryWorld->addCollisionObject(object);
+
+    m_vQueryObject[slot] = object;
+    return true;
+}
+
+void CPhysicsManager::unmirror(glm::uint32 slot)
+{
+    btCollisionObject *object = m_vQueryObject[slot];
+    m_psQueryWorld->removeCollisionObject(object);
+
+    if (object->getCollisionShape()->getShapeType() != TRIANGLE_MESH_SHAPE_PROXYTYPE)
+        delete object->getCollisionShape();
+
+    delete object;
+    m_vQueryObject[slot] = nullptr;
+}
+
+void CPhysicsManager::follow(std::vector<glm::uint32> const &slots)
+{
+    SSnapshot const &front = m_sSnapshot[m_nFront];
+
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        glm::uint32 slot = slots[i];
+        if (slot >= m_vQueryObject.size() || !m_vQueryObject[slot])
+            continue;
+
+        btCollisionObject *object = m_vQueryObject[slot];
+        if (slot >= front.handle.size() || front.handle[slot] != glm::uint32(object->getUserIndex()))
+            continue;
+
+        object->setWorldTransform(btTransform(toBullet(front.rotation[1][slot]),
+                toBullet(front.position[1][slot])));
+        m_psQueryWorld->updateSingleAabb(object);
+    }
+}
+
+void CPhysicsManager::run()
+{
+    double const frequency = double(SDL_GetPerformanceFrequency());
+    Uint64 last = SDL_GetPerformanceCounter();
+    float accumulator = 0.0f;
+
+    while (m_bRunning)
+    {
+        drain();
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        accumulator += std::min(float(double(now - last) / frequency), m_fStep * m_nMaxSubsteps);
+        last = now;
+
+        //! one step per call with bullet's substepping off, the accumulator owns the clock
+        unsigned int steps = 0;
+        while (accumulator >= m_fStep && steps < m_nMaxSubsteps)
+        {
+            advance();
+            accumulator -= m_fStep;
+            steps++;
+        }
+
+        accumulator = std::min(accumulator, m_fStep);
+
+        if (steps > 0)
+            publish();
+
+        std::unique_lock<std::mutex> lock(m_sMutex);
+        m_sWake.wait_for(lock, std::chrono::microseconds(int((m_fStep - accumulator) * 1.0e6f)),
+                [this] { return !m_bRunning; });
+    }
+}
+
+void CPhysicsManager::drain()
+{
+    //! commands run outside the lock
+    {
+        std::lock_guard<std::mutex> lock(m_sMutex);
+        m_vExecuting.swap(m_vCommand);
+    }
+
+    for (size_t i = 0; i < m_vExecuting.size(); i++)
+        execute(m_vExecuting[i]);
+    m_vExecuting.clear();
+}
+
+void CPhysicsManager::advance()
+{
+    //! moves of the buffer about to be reused go to the pending list first
+    m_nState ^= 1;
+    m_nStamp++;
+    collect(m_nState);
+    m_nMoved[m_nState] = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    m_psWorld->stepSimulation(m_fStep, 0, m_fStep);
+    if (m_psSoftWorld)
+        m_psSoftWorld->getWorldInfo().m_sparsesdf.GarbageCollect();
+    Uint64 end = SDL_GetPerformanceCounter();
+    m_nStep++;
+
+    capture();
+
+    if (m_bStats)
+        gather(float(double(end - start) * 1000.0 / double(SDL_GetPerformanceFrequency())));
+}
+
+void CPhysicsManager::execute(SCommand const &command)
+{
+    glm::uint32 slot = command.body & SLOT_MASK;
+
+    if (command.type == E_PC_SPAWN)
+    {
+        SBodyDesc const &desc = command.desc;
+
+        btCollisionShape *shape = nullptr;
+        if (desc.shape == E_PS_MESH)
+        {
+            if (desc.mesh >= m_vMesh.size())
+            {
+                fprintf(stderr, "[ERR] Physics Error: Unknown triangle mesh.");
+                return;
+            }
+
+            shape = m_vMesh[desc.mesh]->shape;
+        }
+        else
+            shape = createShape(desc);
+
+        bool fixed = desc.trigger || desc.shape == E_PS_PLANE || desc.shape == E_PS_MESH;
+        float mass = fixed ? 0.0f : desc.mass;
+        btVector3 inertia(0.0, 0.0, 0.0);
+        if (mass > 0.0f)
+            shape->calculateLocalInertia(mass, inertia);
+
+        grow(slot);
+
+        btTransform transform(toBullet(desc.rotation), toBullet(desc.position));
+        if (desc.trigger)
+        {
+            btPairCachingGhostObject *trigger = new btPairCachingGhostObject();
+            trigger->setCollisionShape(shape);
+            trigger->setWorldTransform(transform);
+            trigger->setCollisionFlags(trigger->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+            trigger->setUserIndex(int(command.body));
+            m_psWorld->addCollisionObject(trigger, btBroadphaseProxy::SensorTrigger,
+                    btBroadphaseProxy::AllFilter & ~btBroadphaseProxy::SensorTrigger);
+
+            m_vTrigger[slot] = trigger;
+        }
+        else
+        {
+            btRigidBody::btRigidBodyConstructionInfo info(mass, new SBodyMotion(this, slot, transform), shape, inertia);
+            info.m_friction = desc.friction;
+            info.m_restitution = desc.restitution;
+
+            btRigidBody *body = new btRigidBody(info);
+            body->setUserIndex(int(command.body));
+            body->setSleepingThresholds(m_fLinearSleep, m_fAngularSleep);
+            body->setDeactivationTime(m_fSleepTime);
+            m_psWorld->addRigidBody(body);
+
+            m_vBody[slot] = body;
+        }
+
+        //! both states start at the spawn point, the first frame does not blend
+        m_vBodyHandle[slot] = command.body;
+        for (int s = 0; s < 2; s++)
+        {
+            m_vPosition[s][slot] = desc.position;
+            m_vRotation[s][slot] = desc.rotation;
+        }
+        markMoved(slot);
+
+        return;
+    }
+
+    if (command.type == E_PC_SOFT)
+    {
+        grow(slot);
+
+        //! no handle keeps it out of queries and triggers
+        btSoftBody *soft = command.soft;
+        soft->setUserIndex(int(INVALID_BODY));
+        m_psSoftWorld->addSoftBody(soft);
+
+        m_vSoft[slot] = soft;
+        m_vBodyHandle[slot] = command.body;
+        for (int s = 0; s < 2; s++)
+        {
+            m_vPosition[s][slot] = glm::vec3(0.0);
+            m_vRotation[s][slot] = glm::quat(1.0, 0.0, 0.0, 0.0);
+        }
+        markMoved(slot);
+
+        return;
+    }
+
+    if (command.type == E_PC_GRAVITY)
+    {
+        m_psWorld->setGravity(toBullet(command.vector));
+        if (m_psSoftWorld)
+            m_psSoftWorld->getWorldInfo().m_gravity = toBullet(command.vector);
+        return;
+    }
+
+    if (command.type == E_PC_TIMESTEP)
+    {
+        m_fStep = command.step;
+        m_nMaxSubsteps = command.maxSubsteps;
+        return;
+    }
+
+    if (command.type == E_PC_JOINT)
+    {
+        glm::uint32 other = command.other & SLOT_MASK;
+        if (slot >= m_vBody.size() || other >= m_vBody.size() || slot == other ||
+                m_vBodyHandle[slot] != command.body || m_vBodyHandle[other] != command.other ||
+                !m_vBody[slot] || !m_vBody[other])
+        {
+            fprintf(stderr, "[ERR] Physics Error: Joint needs two distinct bodies.");
+            return;
+        }
+
+        btTransform frame(shortestArcQuat(btVector3(1.0, 0.0, 0.0), toBullet(command.axis)),
+                toBullet(command.vector));
+        btRigidBody *a = m_vBody[slot];
+        btRigidBody *b = m_vBody[other];
+
+        btConeTwistConstraint *joint = new btConeTwistConstraint(*a, *b,
+                a->getWorldTransform().inverse() * frame, b->getWorldTransform().inverse() * frame);
+        joint->setLimit(command.swing, command.swing, command.twist);
+        m_psWorld->addConstraint(joint, true);
+        return;
+    }
+
+    if (command.type == E_PC_MESH)
+    {
+        //! handles are handed out in queue order
+        buildMesh(command.mesh);
+        m_vMesh.push_back(command.mesh);
+        command.mesh->ready = true;
+        return;
+    }
+
+    if (slot >= m_vBody.size() || m_vBodyHandle[slot] != command.body)
+        return;
+
+    btSoftBody *soft = m_vSoft[slot];
+    if (soft)
+    {
+        switch (command.type)
+        {
+            case E_PC_REMOVE:
+                release(soft);
+
+                m_vSoft[slot] = nullptr;
+                m_vBodyHandle[slot] = INVALID_BODY;
+                markMoved(slot);
+                break;
+
+            //! addForce() gives every node the whole force
+            case E_PC_FORCE:
+                soft->activate(true);
+                soft->addForce(toBullet(command.vector) * (btScalar(1.0) / btScalar(soft->m_nodes.size())));
+                break;
+
+            case E_PC_IMPULSE:
+                if (soft->getTotalMass() > btScalar(0.0))
+                {
+                    soft->activate(true);
+                    soft->addVelocity(toBullet(command.vector) * (btScalar(1.0) / soft->getTotalMass()));
+                }
+                break;
+
+            case E_PC_VELOCITY:
+                soft->activate(true);
+                soft->setVelocity(toBullet(command.vector));
+                break;
+
+            default:
+                break;
+        }
+
+        return;
+    }
+
+    //! capture() never sees triggers, their states are written here
+    btPairCachingGhostObject *trigger = m_vTrigger[slot];
+    if (trigger)
+    {
+        if (command.type == E_PC_REMOVE)
+        {
+            release(trigger);
+
+            m_vTrigger[slot] = nullptr;
+            m_vBodyHandle[slot] = INVALID_BODY;
+            markMoved(slot);
+        }
+        else if (command.type == E_PC_TRANSFORM)
+        {
+            trigger->setWorldTransform(btTransform(toBullet(command.rotation), toBullet(command.vector)));
+            for (int s = 0; s < 2; s++)
+            {
+                m_vPosition[s][slot] = command.vector;
+                m_vRotation[s][slot] = command.rotation;
+            }
+            markMoved(slot);
+        }
+
+        return;
+    }
+
+    btRigidBody *body = m_vBody[slot];
+    switch (command.type)
+    {
+        case E_PC_REMOVE:
+            release(body);
+
+            m_vBody[slot] = nullptr;
+            m_vBodyHandle[slot] = INVALID_BODY;
+            markMoved(slot);
+            break;
+
+        case E_PC_FORCE:
+            body->activate(true);
+            body->applyCentralForce(toBullet(command.vector));
+            break;
+
+        case E_PC_IMPULSE:
+            body->activate(true);
+            body->applyCentralImpulse(toBullet(command.vector));
+            break;
+
+        case E_PC_VELOCITY:
+            body->activate(true);
+            body->setLinearVelocity(toBullet(command.vector));
+            break;
+
+        case E_PC_TRANSFORM:
+        {
+            //! a teleport: both states take it so the frame does not blend across it
+            btTransform transform(toBullet(command.rotation), toBullet(command.vector));
+            body->setWorldTransform(transform);
+            body->setInterpolationWorldTransform(transform);
+            body->getMotionState()->setWorldTransform(transform);
+            m_vPosition[m_nState ^ 1][slot] = command.vector;
+            m_vRotation[m_nState ^ 1][slot] = command.rotation;
+            body->activate(true);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void CPhysicsManager::grow(glm::uint32 slot)
+{
+    if (slot < m_vBody.size())
+        return;
+
+    m_vBody.resize(slot + 1, nullptr);
+    m_vTrigger.resize(slot + 1, nullptr);
+    m_vSoft.resize(slot + 1, nullptr);
+    m_vBodyHandle.resize(slot + 1, INVALID_BODY);
+    m_vMovedStamp.resize(slot + 1, 0);
+    m_vPendingStamp.resize(slot + 1, 0);
+    for (int s = 0; s < 2; s++)
+    {
+        m_vPosition[s].resize(slot + 1);
+        m_vRotation[s].resize(slot + 1);
+        m_vMoved[s].resize(slot + 1);
+    }
+}
+
+void CPhysicsManager::markMoved(glm::uint32 slot)
+{
+    //! no body is written from two threads at once, only the list index is shared
+    if (m_vMovedStamp[slot] == m_nStamp)
+        return;
+
+    m_vMovedStamp[slot] = m_nStamp;
+    m_vMoved[m_nState][m_nMoved[m_nState]++] = slot;
+}
+
+void CPhysicsManager::collect(unsigned int state)
+{
+    for (unsigned int i = 0; i < m_nMoved[state]; i++)
+    {
+        glm::uint32 slot = m_vMoved[state][i];
+        if (m_vPendingStamp[slot] != m_nPublished)
+        {
+            m_vPendingStamp[slot] = m_nPublished;
+            m_vMovedPending.push_back(slot);
+        }
+    }
+}
+
+void CPhysicsManager::capture()
+{
+    //! a body that came to rest last step is still behind in this buffer
+    unsigned int previous = m_nState ^ 1;
+
+    for (unsigned int i = 0; i < m_nMoved[previous]; i++)
+    {
+        glm::uint32 slot = m_vMoved[previous][i];
+        if (m_vMovedStamp[slot] == m_nStamp)
+            continue;
+
+        m_vPosition[m_nState][slot] = m_vPosition[previous][slot];
+        m_vRotation[m_nState][slot] = m_vRotation[previous][slot];
+    }
 }
 
+void CPhysicsManager::gather(float milliseconds)
+{
+    m_sStats.milliseconds = milliseconds;
+    m_sStats.pairs = m_psBroadphase->getOverlappingPairCache()->getNumOverlappingPairs();
+
+    btDispatcher *dispatcher = m_psWorld->getDispatcher();
+    m_sStats.manifolds = dispatcher->getNumManifolds();
+    m_sStats.contacts = 0;
+    for (unsigned int i = 0; i < m_sStats.manifolds; i++)
+        m_sStats.contacts += dispatcher->getManifoldByIndexInternal(i)->getNumContacts();
+
+    //! island tags are union find roots; static objects carry -1
+    btCollisionObjectArray const &objects = m_psWorld->getCollisionObjectArray();
+    m_vIsland.assign(objects.size(), 0);
+    m_sStats.islands = 0;
+    m_sStats.active = 0;
+    for (int i = 0; i < objects.size(); i++)
+    {
+        btCollisionObject const *object = objects[i];
+        if (object->isStaticOrKinematicObject() || !object->isActive())
+            continue;
+
+        m_sStats.active++;
+
+        int tag = object->getIslandTag();
+        if (tag >= 0 && tag < objects.size() && !m_vIsland[tag])
+        {
+            m_vIsland[tag] = 1;
+            m_sStats.islands++;
+        }
+    }
+
+    m_sStats.nodes = 0;
+    if (m_psSoftWorld)
+    {
+        btSoftBodyArray const &softs = m_psSoftWorld->getSoftBodyArray();
+        for (int i = 0; i < softs.size(); i++)
+        {
+            if (softs[i]->isActive())
+                m_sStats.nodes += softs[i]->m_nodes.size();
+        }
+    }
+
+    profile();
+}
+
+void CPhysicsManager::profile()
+{
+    m_sStats.sectionCount = 0;
+
+#ifndef BT_NO_PROFILE
+    CProfileIterator *it = CProfileManager::Get_Iterator();
+
+    unsigned int depth = 0;
+    int index[3] = { 0, 0, 0 };
+    it->First();
+    while (true)
+    {
+        if (it->Is_Done())
+        {
+            if (depth == 0)
+                break;
+
+            it->Enter_Parent();
+            depth--;
+            index[depth]++;
+
+            //! Enter_Parent rewinds to the first child
+            it->First();
+            for (int i = 0; i < index[depth] && !it->Is_Done(); i++)
+                it->Next();
+            continue;
+        }
+
+        if (m_sStats.sectionCount < SStepStats::MAX_SECTIONS)
+        {
+            SProfileSection &section = m_sStats.sections[m_sStats.sectionCount++];
+            section.name = it->Get_Current_Name();
+            section.depth = depth;
+            section.milliseconds = it->Get_Current_Total_Time();
+        }
+
+        if (depth + 1 < 3)
+        {
+            it->Enter_Child(index[depth]);
+            depth++;
+            index[depth] = 0;
+            it->First();
+        }
+        else
+        {
+            index[depth]++;
+            it->Next();
+        }
+    }
+
+    CProfileManager::Release_Iterator(it);
+#endif
+}
+
+void CPhysicsManager::publish()
+{
+    SSnapshot &back = m_sSnapshot[m_nBack];
+
+    //! a dropped snapshot passes its moved slots on
+    collect(0);
+    collect(1);
+    if (m_bDropped)
+    {
+        for (size_t i = 0; i < back.moved.size(); i++)
+        {
+            glm::uint32 slot = back.moved[i];
+            if (m_vPendingStamp[slot] != m_nPublished)
+            {
+                m_vPendingStamp[slot] = m_nPublished;
+                m_vMovedPending.push_back(slot);
+            }
+        }
+    }
+
+    //! copy only the slots this buffer is behind on
+    for (unsigned int b = 0; b < 3; b++)
+    {
+        if (b == m_nBack)
+            continue;
+
+        m_vStaleMark[b].resize(m_vBodyHandle.size(), 0);
+        for (size_t i = 0; i < m_vMovedPending.size(); i++)
+        {
+            glm::uint32 slot = m_vMovedPending[i];
+            if (!m_vStaleMark[b][slot])
+            {
+                m_vStaleMark[b][slot] = 1;
+                m_vStale[b].push_back(slot);
+            }
+        }
+    }
+
+    back.handle.resize(m_vBodyHandle.size(), INVALID_BODY);
+    for (int s = 0; s < 2; s++)
+    {
+        back.position[s].resize(m_vBodyHandle.size());
+        back.rotation[s].resize(m_vBodyHandle.size(), glm::quat(1.0, 0.0, 0.0, 0.0));
+    }
+
+    std::vector<glm::uint32> const *lists[2] = { &m_vStale[m_nBack], &m_vMovedPending };
+    for (int l = 0; l < 2; l++)
+    {
+        for (size_t i = 0; i < lists[l]->size(); i++)
+        {
+            glm::uint32 slot = (*lists[l])[i];
+            back.handle[slot] = m_vBodyHandle[slot];
+            back.position[0][slot] = m_vPosition[m_nState ^ 1][slot];
+            back.position[1][slot] = m_vPosition[m_nState][slot];
+            back.rotation[0][slot] = m_vRotation[m_nState ^ 1][slot];
+            back.rotation[1][slot] = m_vRotation[m_nState][slot];
+        }
+    }
+
+    for (size_t i = 0; i < m_vStale[m_nBack].size(); i++)
+        m_vStaleMark[m_nBack][m_vStale[m_nBack][i]] = 0;
+    m_vStale[m_nBack].clear();
+
+    back.moved.swap(m_vMovedPending);
+    m_vMovedPending.clear();
+    back.moving.assign(m_vMoved[m_nState].begin(), m_vMoved[m_nState].begin() + m_nMoved[m_nState]);
+
+    back.counter = SDL_GetPerformanceCounter();
+    back.step = m_nStep;
+    back.stepLength = m_fStep;
+    back.stats = m_sStats;
+
+    if (m_psSoftWorld)
+    {
+        back.softFirst.assign(m_vSoft.size(), NO_VERTICES);
+        glm::uint32 count = 0;
+        for (size_t slot = 0; slot < m_vSoft.size(); slot++)
+        {
+            if (!m_vSoft[slot])
+                continue;
+
+            back.softFirst[slot] = count;
+            count += 2 * m_vSoft[slot]->m_nodes.size();
+        }
+
+        back.softVertex.resize(count);
+
+        #pragma omp parallel for schedule(dynamic, 1) if (count >= PARALLEL_VERTICES)
+        for (int slot = 0; slot < int(m_vSoft.size()); slot++)
+        {
+            btSoftBody const *soft = m_vSoft[slot];
+            if (!soft)
+                continue;
+
+            glm::vec3 *vertex = &back.softVertex[back.softFirst[slot]];
+            for (int n = 0; n < soft->m_nodes.size(); n++)
+            {
+                vertex[2 * n + 0] = toGlm(soft->m_nodes[n].m_x);
+                vertex[2 * n + 1] = toGlm(soft->m_nodes[n].m_n);
+            }
+        }
+    }
+
+    //! events pile up until read, never dropped with a snapshot
+    if (!m_vTriggerPending.empty())
+    {
+        std::lock_guard<std::mutex> lock(m_sMutex);
+        m_vTriggerMailbox.insert(m_vTriggerMailbox.end(), m_vTriggerPending.begin(), m_vTriggerPending.end());
+        m_vTriggerPending.clear();
+    }
+
+    //! a buffer coming back still fresh was never read
+    unsigned int previous = m_nReady.exchange(m_nBack | FRESH);
+    m_nBack = previous & (FRESH - 1);
+    m_bDropped = (previous & FRESH) != 0;
+    m_nPublished++;
+}
+
+void CPhysicsManager::release(btRigidBody *body)
+{
+    while (body->getNumConstraintRefs() > 0)
+    {
+        btTypedConstraint *joint = body->getConstraintRef(0);
+        m_psWorld->removeConstraint(joint);
+        delete joint;
+    }
+
+    m_psWorld->removeRigidBody(body);
+    delete body->getMotionState();
+
+    //! triangle mesh shapes are shared and belong to m_vMesh
+    if (body->getCollisionShape()->getShapeType() != TRIANGLE_MESH_SHAPE_PROXYTYPE)
+        delete body->getCollisionShape();
+
+    delete body;
+}
+
+void CPhysicsManager::release(btPairCachingGhostObject *trigger)
+{
+    //! no handle means the pair callback drops the exits removal causes
+    trigger->setUserIndex(int(INVALID_BODY));
+    m_psWorld->removeCollisionObject(trigger);
+
+    if (trigger->getCollisionShape()->getShapeType() != TRIANGLE_MESH_SHAPE_PROXYTYPE)
+        delete trigger->getCollisionShape();
+
+    delete trigger;
+}
+
+void CPhysicsManager::release(btSoftBody *soft)
+{
+    m_psSoftWorld->removeSoftBody(soft);
+    delete soft;
+}
+
+void CPhysicsManager::runRays(btCollisionWorld *world, SRay const *rays, SHit *hits, size_t count)
+{
+    btBroadphaseInterface *broadphase = world->getBroadphase();
+    btVector3 const zero(0.0, 0.0, 0.0);
+
+    #pragma omp parallel if (count >= PARALLEL_QUERIES)
+    {
+        btAlignedObjectArray<btDbvtNode const *> stack;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < int(count); i++)
+        {
+            btVector3 from = toBullet(rays[i].from), to = toBullet(rays[i].to);
+            btTransform fromTransform(btQuaternion::getIdentity(), from);
+            btTransform toTransform(btQuaternion::getIdentity(), to);
+
+            btCollisionWorld::ClosestRayResultCallback callback(from, to);
+            auto visit = [&](btCollisionObject *object)
+            {
+                if (isBody(object))
+                    btCollisionWorld::rayTestSingle(fromTransform, toTransform, object,
+                            object->getCollisionShape(), object->getWorldTransform(), callback);
+            };
+            gatherSegment(world, broadphase, from, to, zero, stack, visit);
+
+            SHit &hit = hits[i];
+            hit.body = INVALID_BODY;
+            hit.fraction = 1.0;
+            hit.point = glm::vec3(0.0);
+            hit.normal = glm::vec3(0.0);
+            if (callback.hasHit())
+            {
+                hit.body = toBody(callback.m_collisionObject);
+                hit.fraction = callback.m_closestHitFraction;
+                hit.point = toGlm(callback.m_hitPointWorld);
+                hit.normal = toGlm(callback.m_hitNormalWorld);
+            }
+        }
+    }
+}
+
+void CPhysicsManager::runSweeps(btCollisionWorld *world, SSweep const *sweeps, SHit *hits, size_t count)
+{
+    btBroadphaseInterface *broadphase = world->getBroadphase();
+
+    #pragma omp parallel if (count >= PARALLEL_QUERIES)
+    {
+        btAlignedObjectArray<btDbvtNode const *> stack;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < int(count); i++)
+        {
+            btSphereShape sphere(sweeps[i].radius);
+            btVector3 from = toBullet(sweeps[i].from), to = toBullet(sweeps[i].to);
+            btTransform fromTransform(btQuaternion::getIdentity(), from);
+            btTransform toTransform(btQuaternion::getIdentity(), to);
+
+            btCollisionWorld::ClosestConvexResultCallback callback(from, to);
+            auto visit = [&](btCollisionObject *object)
+            {
+                if (isBody(object))
+                    btCollisionWorld::objectQuerySingle(&sphere, fromTransform, toTransform, object,
+                            object->getCollisionShape(), object->getWorldTransform(), callback, 0.0);
+            };
+
+            btVector3 extent(sweeps[i].radius, sweeps[i].radius, sweeps[i].radius);
+            gatherSegment(world, broadphase, from, to, extent, stack, visit);
+
+            SHit &hit = hits[i];
+            hit.body = INVALID_BODY;
+            hit.fraction = 1.0;
+            hit.point = glm::vec3(0.0);
+            hit.normal = glm::vec3(0.0);
+            if (callback.hasHit())
+            {
+                hit.body = toBody(callback.m_hitCollisionObject);
+                hit.fraction = callback.m_closestHitFraction;
+                hit.point = toGlm(callback.m_hitPointWorld);
+                hit.normal = toGlm(callback.m_hitNormalWorld);
+            }
+        }
+    }
+}
+
+void CPhysicsManager::runOverlaps(btCollisionWorld *world, SSphere const *spheres, glm::uint32 *bodies,
+        glm::uint32 *counts, size_t count, size_t capacity)
+{
+    btBroadphaseInterface *broadphase = world->getBroadphase();
+
+    #pragma omp parallel if (count >= PARALLEL_QUERIES)
+    {
+        btAlignedObjectArray<btDbvtNode const *> stack;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < int(count); i++)
+        {
+            btSphereShape sphere(spheres[i].radius);
+            btVector3 center = toBullet(spheres[i].center);
+            btTransform at(btQuaternion::getIdentity(), center);
+
+            glm::uint32 found = 0;
+            glm::uint32 *out = bodies + i * capacity;
+            auto visit = [&](btCollisionObject *object)
+            {
+                if (!isBody(object) || !overlapsSphere(object, sphere, at))
+                    return;
+
+                if (found < capacity)
+                    out[found] = toBody(object);
+                found++;
+            };
+
+            btVector3 extent(spheres[i].radius, spheres[i].radius, spheres[i].radius);
+            gatherSegment(world, broadphase, center, center, extent, stack, visit);
+
+            counts[i] = found;
+        }
+    }
+}
+
+void CPhysicsManager::buildMesh(STriangleMesh *mesh)
+{
+    btIndexedMesh part;
+    part.m_numTriangles = mesh->indices.size() / 3;
+    part.m_triangleIndexBase = reinterpret_cast<unsigned char const *>(&mesh->indices[0]);
+    part.m_triangleIndexStride = 3 * sizeof(glm::uint32);
+    part.m_numVertices = mesh->vertices.size();
+    part.m_vertexBase = reinterpret_cast<unsigned char const *>(&mesh->vertices[0]);
+    part.m_vertexStride = sizeof(glm::vec3);
+    part.m_indexType = PHY_INTEGER;
+    part.m_vertexType = PHY_FLOAT;
+
+    mesh->array = new btTriangleIndexVertexArray();
+    mesh->array->addIndexedMesh(part, PHY_INTEGER);
+
+    glm::uint64 hash = hashBytes(&mesh->vertices[0], mesh->vertices.size() * sizeof(glm::vec3));
+    hash = hashBytes(&mesh->indices[0], mesh->indices.size() * sizeof(glm::uint32), hash);
+
+    if (!mesh->cache.empty() && loadBvh(mesh, hash))
+        return;
+
+    //! the cache only holds quantized trees
+    mesh->shape = new btBvhTriangleMeshShape(mesh->array, true, true);
+
+    if (!mesh->cache.empty())
+        saveBvh(mesh, hash);
+}
+
+bool CPhysicsManager::loadBvh(STriangleMesh *mesh, glm::uint64 hash)
+{
+    FILE *in = fopen(mesh->cache.c_str(), "rb");
+    if (!in)
+        return false;
+
+    SBvhHeader header;
+    bool valid = fread(&header, sizeof(header), 1, in) == 1 &&
+        memcmp(header.magic, "VBV1", 4) == 0 && header.version == 1 &&
+        header.bullet == BT_BULLET_VERSION &&
+        header.vertices == mesh->vertices.size() &&
+        header.indices == mesh->indices.size() &&
+        header.hash == hash && header.size > 0;
+
+    //! deserialized in place, the buffer lives as long as the shape
+    void *buffer = valid ? btAlignedAlloc(header.size, 16) : nullptr;
+    if (buffer && fread(buffer, 1, header.size, in) != header.size)
+        valid = false;
+
+    fclose(in);
+
+    btOptimizedBvh *bvh = nullptr;
+    if (valid && buffer)
+        bvh = btOptimizedBvh::deSerializeInPlace(buffer, header.size, false);
+
+    if (!bvh || !bvh->isQuantized())
+    {
+        if (bvh)
+            bvh->~btOptimizedBvh();
+        if (buffer)
+            btAlignedFree(buffer);
+
+        return false;
+    }
+
+    mesh->shape = new btBvhTriangleMeshShape(mesh->array, true, false);
+    mesh->shape->setOptimizedBvh(bvh);
+    mesh->bvh = buffer;
+
+    return true;
+}
+
+void CPhysicsManager::saveBvh(STriangleMesh const *mesh, glm::uint64 hash)
+{
+    btOptimizedBvh *bvh = mesh->shape->getOptimizedBvh();
+
+    SBvhHeader header;
+    memcpy(header.magic, "VBV1", 4);
+    header.version = 1;
+    header.bullet = BT_BULLET_VERSION;
+    header.vertices = mesh->vertices.size();
+    header.indices = mesh->indices.size();
+    header.size = bvh->calculateSerializeBufferSize();
+    header.hash = hash;
+
+    void *buffer = btAlignedAlloc(header.size, 16);
+    bool serialized = bvh->serializeInPlace(buffer, header.size, false);
+
+    //! written aside and renamed over, never half a cache
+    std::string temp = mesh->cache + ".tmp";
+    FILE *out = serialized ? fopen(temp.c_str(), "wb") : nullptr;
+    if (out)
+    {
+        bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+            fwrite(buffer, 1, header.size, out) == header.size;
+        written = (fclose(out) == 0) && written;
+
+        if (!written || rename(temp.c_str(), mesh->cache.c_str()) != 0)
+        {
+            fprintf(stderr, "[ERR] Physics Error: Unable to write %s.", mesh->cache.c_str());
+            unlink(temp.c_str());
+        }
+    }
+
+    btAlignedFree(buffer);
+}
+
+void CPhysicsManager::destroyMesh(STriangleMesh *mesh)
+{
+    delete mesh->shape;
+
+    //! the tree was handed in and points into the buffer
+    if (mesh->bvh)
+    {
+        btOptimizedBvh *bvh = static_cast<btOptimizedBvh *>(mesh->bvh);
+        bvh->~btOptimizedBvh();
+        btAlignedFree(mesh->bvh);
+    }
+
+    delete mesh->array;
+    delete mesh;
+}
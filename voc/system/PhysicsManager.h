@@ -20,24 +20,565 @@
 
 #include "../Commons.h"
 
+//! the bullet world on its own thread; callers queue commands and read snapshots
 class CPhysicsManager
 {
 public:
+    static const glm::uint32 INVALID_BODY = 0xFFFFFFFF;
+    static const glm::uint32 INVALID_MESH = 0xFFFFFFFF;
+
+    enum EShape
+    {
+        E_PS_BOX = 0,
+        E_PS_SPHERE,
+        E_PS_CAPSULE,
+        E_PS_PLANE,
+        E_PS_MESH
+    };
+
+    struct SBodyDesc
+    {
+        EShape shape;
+
+        //! box half extents; radius in x; capsule height in y; plane normal
+        glm::vec3 size;
+
+        glm::uint32 mesh;
+
+        float mass;
+        float friction;
+        float restitution;
+
+        glm::vec3 position;
+        glm::quat rotation;
+
+        //! collides with nothing, overlaps go to getTriggerEvents()
+        bool trigger;
+
+        SBodyDesc()
+            : shape(E_PS_BOX),
+            size(0.5),
+            mesh(INVALID_MESH),
+            mass(1.0),
+            friction(0.5),
+            restitution(0.0),
+            position(0.0),
+            trigger(false)
+        {
+        }
+    };
+
+    enum ESoftShape
+    {
+        E_SS_ROPE = 0,
+        E_SS_CLOTH,
+        E_SS_BLOB
+    };
+
+    //! needs SConfig::softBodies
+    struct SSoftBodyDesc
+    {
+        ESoftShape shape;
+
+        //! rope ends in 0, 1; cloth corners 00, 10, 01, 11; blob center in 0, radii in 1
+        glm::vec3 points[4];
+
+        //! rope segments or blob nodes in 0; cloth nodes per side in 0 and 1
+        unsigned int resolution[2];
+
+        //! bit i pins the node at points[i]
+        unsigned int pinned;
+
+        float mass;
+        float friction;
+
+        float stiffness;
+
+        float pressure;
+
+        SSoftBodyDesc()
+            : shape(E_SS_CLOTH),
+            pinned(0),
+            mass(1.0),
+            friction(0.5),
+            stiffness(1.0),
+            pressure(0.0)
+        {
+            for (int i = 0; i < 4; i++)
+                points[i] = glm::vec3(0.0);
+            resolution[0] = 16;
+            resolution[1] = 16;
+        }
+    };
+
+    //! lines for ropes, triangles otherwise, indexing getSoftVertices()
+    struct SSoftTopology
+    {
+        std::vector<glm::uint32> indices;
+        unsigned int nodes;
+        bool lines;
+
+        SSoftTopology() : nodes(0), lines(false) {}
+    };
+
+    struct SRay
+    {
+        glm::vec3 from;
+        glm::vec3 to;
+    };
+
+    struct SSweep
+    {
+        glm::vec3 from;
+        glm::vec3 to;
+        float radius;
+    };
+
+    struct SSphere
+    {
+        glm::vec3 center;
+        float radius;
+    };
+
+    //! removing a body inside a trigger reports its exit, removing a trigger nothing
+    struct STriggerEvent
+    {
+        glm::uint32 trigger;
+        glm::uint32 body;
+        glm::uint64 step;
+        bool enter;
+    };
+
+    enum EBroadphase
+    {
+        E_PB_DBVT = 0,
+        E_PB_AXIS_SWEEP
+    };
+
+    struct SProfileSection
+    {
+        char const *name;
+        unsigned int depth;
+        float milliseconds;
+    };
+
+    //! only gathered with SConfig::stats
+    struct SStepStats
+    {
+        enum
+        {
+            MAX_SECTIONS = 24
+        };
+
+        unsigned int pairs;
+        unsigned int manifolds;
+        unsigned int contacts;
+
+        unsigned int islands;
+        unsigned int active;
+
+        unsigned int nodes;
+
+        float milliseconds;
+
+        //! empty when bullet is built with BT_NO_PROFILE
+        SProfileSection sections[MAX_SECTIONS];
+        unsigned int sectionCount;
+
+        SStepStats()
+            : pairs(0), manifolds(0), contacts(0), islands(0), active(0), nodes(0), milliseconds(0.0f),
+            sectionCount(0)
+        {
+        }
+    };
+
+    //! bound bodies moved as of the last update(), blended
+    struct SMovedBodies
+    {
+        std::vector<glm::uint32> transform;
+        std::vector<glm::vec3> position;
+        std::vector<glm::quat> rotation;
+    };
+
+    //! body is INVALID_BODY on a miss
+    struct SHit
+    {
+        glm::uint32 body;
+        float fraction;
+        glm::vec3 point;
+        glm::vec3 normal;
+    };
+
+    //! the <physics> element of app_config.xml
+    struct SConfig
+    {
+        //! needs bullet with BT_THREADSAFE and make BULLET_MT=1
+        bool multithreaded;
+
+        //! 0 runs one per core
+        unsigned int threads;
+
+        //! no physics thread, the owner calls step()
+        bool manual;
+
+        bool stats;
+
+        //! forces the single threaded world
+        bool softBodies;
+
+        //! the axis sweep needs everything between worldMin and worldMax
+        EBroadphase broadphase;
+        glm::vec3 worldMin;
+        glm::vec3 worldMax;
+        unsigned int maxProxies;
+
+        unsigned int iterations;
+
+        float linearSleep;
+        float angularSleep;
+        float sleepTime;
+
+        float contactBreaking;
+
+        glm::vec3 gravity;
+
+        SConfig()
+            : multithreaded(false),
+            threads(0),
+            manual(false),
+            stats(false),
+            softBodies(false),
+            broadphase(E_PB_DBVT),
+            worldMin(-1000.0),
+            worldMax(1000.0),
+            maxProxies(16384),
+            iterations(10),
+            linearSleep(0.8),
+            angularSleep(1.0),
+            sleepTime(2.0),
+            contactBreaking(0.02),
+            gravity(0.0, -9.8, 0.0)
+        {
+        }
+    };
+
+    static SConfig loadConfig(char const *file);
+
     explicit CPhysicsManager();
     ~CPhysicsManager();
 
-    void init();
+    void init(SConfig const &config = SConfig());
     void destroy();
+
+    //! manual mode only
+    void step();
+
+    unsigned int getThreadCount() const { return m_nThreads; }
+
+    //! false whenever init() had to fall back
+    bool isMultithreaded() const { return m_bMultithreaded; }
+
+    //! never blocks on the physics thread
     void update();
 
-    btDiscreteDynamicsWorld* getDynamicsWorld() const { return m_psWorld; }
+    glm::uint32 spawn(SBodyDesc const &desc);
+    void remove(glm::uint32 body);
+
+    //! built here, added on the physics thread; never hit by queries or triggers
+    glm::uint32 spawnSoft(SSoftBodyDesc const &desc);
+    bool hasSoftBodies() const { return m_psSoftWorld != nullptr; }
+
+    SSoftTopology const *getSoftTopology(glm::uint32 body) const;
+
+    //! position and normal per node, not interpolated
+    glm::vec3 const *getSoftVertices(glm::uint32 body) const;
+
+    //! shared by key; the bvh is built on the physics thread or read from cache
+    glm::uint32 createMesh(std::string const &key, std::vector<glm::vec3> &&vertices,
+            std::vector<glm::uint32> &&indices, std::string const &cache = std::string());
+    glm::uint32 findMesh(std::string const &key) const;
+
+    //! run on the calling thread against the snapshot update() picked up
+    void raycast(SRay const *rays, SHit *hits, size_t count);
+    void sweep(SSweep const *sweeps, SHit *hits, size_t count);
+
+    //! up to capacity bodies per sphere at bodies[i * capacity], counts[i] in total
+    void overlap(SSphere const *spheres, glm::uint32 *bodies, glm::uint32 *counts,
+            size_t count, size_t capacity);
+
+    //! removing either body removes the joint
+    void connect(glm::uint32 a, glm::uint32 b, glm::vec3 const &pivot, glm::vec3 const &axis,
+            float swing, float twist);
+
+    void applyForce(glm::uint32 body, glm::vec3 const &force);
+    void applyImpulse(glm::uint32 body, glm::vec3 const &impulse);
+    void setVelocity(glm::uint32 body, glm::vec3 const &velocity);
+    void setTransform(glm::uint32 body, glm::vec3 const &position, glm::quat const &rotation);
+    void setGravity(glm::vec3 const &gravity);
+
+    //! frame time past maxSubsteps steps is dropped
+    void setFixedTimestep(float step, unsigned int maxSubsteps);
+
+    //! blended between the last two steps; false until stepped
+    bool getTransform(glm::uint32 body, glm::vec3 &position, glm::quat &rotation) const;
+
+    //! update() reports the body's moves under this transform handle
+    void bind(glm::uint32 body, glm::uint32 transform);
+
+    SMovedBodies const &getMovedBodies() const { return m_sMoved; }
+
+    //! never dropped along with a snapshot
+    std::vector<STriggerEvent> const &getTriggerEvents() const { return m_vTriggerEvent; }
+
+    float getInterpolation() const { return m_fInterpolation; }
+
+    glm::uint64 getStepCount() const { return m_sSnapshot[m_nFront].step; }
+
+    SStepStats const &getStepStats() const { return m_sSnapshot[m_nFront].stats; }
 
 private:
+    CPhysicsManager(const CPhysicsManager &pm);
+    CPhysicsManager& operator=(const CPhysicsManager &pm);
+
+    enum ECommand
+    {
+        E_PC_SPAWN = 0,
+        E_PC_REMOVE,
+        E_PC_FORCE,
+        E_PC_IMPULSE,
+        E_PC_VELOCITY,
+        E_PC_TRANSFORM,
+        E_PC_GRAVITY,
+        E_PC_TIMESTEP,
+        E_PC_MESH,
+        E_PC_JOINT,
+        E_PC_SOFT
+    };
+
+    //! owned by the physics thread; ready hands the shape to the calling thread
+    struct STriangleMesh
+    {
+        std::vector<glm::vec3> vertices;
+        std::vector<glm::uint32> indices;
+        std::string cache;
+
+        btTriangleIndexVertexArray *array;
+        btBvhTriangleMeshShape *shape;
+        void *bvh;
+        std::atomic<bool> ready;
+
+        STriangleMesh() : array(nullptr), shape(nullptr), bvh(nullptr), ready(false) {}
+    };
+
+    //! followed by the serialized btOptimizedBvh
+    struct SBvhHeader
+    {
+        char magic[4];
+        glm::uint32 version;
+        glm::uint32 bullet;
+        glm::uint32 vertices;
+        glm::uint32 indices;
+        glm::uint32 size;
+        glm::uint64 hash;
+    };
+
+    struct SCommand
+    {
+        ECommand type;
+        glm::uint32 body;
+
+        //! ownership passes to the physics thread
+        STriangleMesh *mesh;
+        btSoftBody *soft;
+
+        SBodyDesc desc;
+        glm::vec3 vector;
+        glm::vec3 axis;
+        glm::quat rotation;
+        glm::uint32 other;
+        float swing;
+        float twist;
+        float step;
+        unsigned int maxSubsteps;
+    };
+
+    //! one published state by slot; handle is INVALID_BODY for free slots
+    struct SSnapshot
+    {
+        std::vector<glm::uint32> handle;
+        std::vector<glm::vec3> position[2];
+        std::vector<glm::quat> rotation[2];
+
+        //! softFirst by slot, NO_VERTICES for other slots
+        std::vector<glm::vec3> softVertex;
+        std::vector<glm::uint32> softFirst;
+
+        //! moved: changed since the last snapshot read; moving: still blending
+        std::vector<glm::uint32> moved;
+        std::vector<glm::uint32> moving;
+
+        Uint64 counter;
+        glm::uint64 step;
+        float stepLength;
+        SStepStats stats;
+
+        SSnapshot() : counter(0), step(0), stepLength(1.0f / 60.0f) {}
+    };
+
+    enum
+    {
+        SLOT_BITS = 20,
+        SLOT_MASK = (1 << SLOT_BITS) - 1,
+
+        //! set in m_nReady while it holds an unread snapshot
+        FRESH = 4,
+
+        PARALLEL_QUERIES = 256,
+
+        PARALLEL_VERTICES = 16384,
+
+        NO_VERTICES = 0xFFFFFFFF,
+        UNBOUND = 0xFFFFFFFF
+    };
+
+    glm::uint32 allocate();
+    void queue(SCommand const &command);
+    void bridge(std::vector<glm::uint32> const &slots);
+
+    //! calling thread
+    btCollisionWorld *queryWorld();
+    bool mirror(SCommand const &spawn);
+    void unmirror(glm::uint32 slot);
+    void follow(std::vector<glm::uint32> const &slots);
+
+    //! physics thread
+    void run();
+    void drain();
+    void advance();
+    void execute(SCommand const &command);
+    void grow(glm::uint32 slot);
+    void markMoved(glm::uint32 slot);
+    void collect(unsigned int state);
+    void capture();
+    void gather(float milliseconds);
+    void profile();
+    void publish();
+    void release(btRigidBody *body);
+    void release(btPairCachingGhostObject *trigger);
+    void release(btSoftBody *soft);
+
+    void runRays(btCollisionWorld *world, SRay const *rays, SHit *hits, size_t count);
+    void runSweeps(btCollisionWorld *world, SSweep const *sweeps, SHit *hits, size_t count);
+    void runOverlaps(btCollisionWorld *world, SSphere const *spheres, glm::uint32 *bodies,
+            glm::uint32 *counts, size_t count, size_t capacity);
+
+    void buildMesh(STriangleMesh *mesh);
+    bool loadBvh(STriangleMesh *mesh, glm::uint64 hash);
+    void saveBvh(STriangleMesh const *mesh, glm::uint64 hash);
+    void destroyMesh(STriangleMesh *mesh);
+
     btBroadphaseInterface *m_psBroadphase;
     btDefaultCollisionConfiguration *m_psCollisionConfiguration;
     btCollisionDispatcher *m_psDispatcher;
-    btSequentialImpulseConstraintSolver *m_psSolver;
+    btConstraintSolver *m_psSolver;
+    btConstraintSolverPoolMt *m_psSolverPool;
     btDiscreteDynamicsWorld *m_psWorld;
+
+    //! m_psWorld when it takes soft bodies
+    btSoftRigidDynamicsWorld *m_psSoftWorld;
+    struct SSoftSolver;
+    SSoftSolver *m_psSoftSolver;
+
+    struct SBodyMotion;
+
+    struct STriggerPairs;
+    STriggerPairs *m_psTriggerPairs;
+
+    //! owned only when created here
+    btITaskScheduler *m_psScheduler;
+    unsigned int m_nThreads;
+    bool m_bMultithreaded;
+
+    std::thread m_sThread;
+    std::atomic<bool> m_bRunning;
+
+    //! guards the command queue and the trigger mailbox
+    std::mutex m_sMutex;
+    std::vector<SCommand> m_vCommand;
+    std::vector<STriggerEvent> m_vTriggerMailbox;
+    std::condition_variable m_sWake;
+
+    //! calling thread only, never simulated; null in manual mode
+    btNullPairCache *m_psQueryPairs;
+    btDbvtBroadphase *m_psQueryBroadphase;
+    btCollisionDispatcher *m_psQueryDispatcher;
+    btCollisionWorld *m_psQueryWorld;
+    std::vector<btCollisionObject *> m_vQueryObject;
+
+    //! mesh body spawns waiting for their shape
+    std::vector<STriangleMesh *> m_vQueryMesh;
+    std::vector<SCommand> m_vQueryPending;
+
+    //! calling thread only
+    std::vector<glm::uint32> m_vGeneration;
+    std::vector<glm::uint32> m_vFreeSlot;
+    std::map<std::string, glm::uint32> m_mMeshHandle;
+    std::vector<STriggerEvent> m_vTriggerEvent;
+    std::vector<SSoftTopology> m_vSoftTopology;
+
+    //! m_vMovedFrame keeps a body from being reported twice a frame
+    std::vector<glm::uint32> m_vBinding;
+    std::vector<glm::uint32> m_vRebound;
+    std::vector<glm::uint64> m_vMovedFrame;
+    glm::uint64 m_nFrame;
+    SMovedBodies m_sMoved;
+
+    //! physics thread only
+    std::vector<btRigidBody *> m_vBody;
+    std::vector<btPairCachingGhostObject *> m_vTrigger;
+    std::vector<btSoftBody *> m_vSoft;
+    std::vector<STriggerEvent> m_vTriggerPending;
+    std::vector<glm::uint32> m_vBodyHandle;
+    std::vector<glm::vec3> m_vPosition[2];
+    std::vector<glm::quat> m_vRotation[2];
+    std::vector<SCommand> m_vExecuting;
+
+    //! per state buffer, the first m_nMoved entries; the stamp lists a slot once
+    std::vector<glm::uint32> m_vMoved[2];
+    std::atomic<unsigned int> m_nMoved[2];
+    std::vector<glm::uint64> m_vMovedStamp;
+    glm::uint64 m_nStamp;
+
+    std::vector<glm::uint32> m_vMovedPending;
+    std::vector<glm::uint64> m_vPendingStamp;
+    glm::uint64 m_nPublished;
+
+    //! per snapshot buffer, the slots publish() has yet to copy
+    std::vector<glm::uint32> m_vStale[3];
+    std::vector<glm::uint8> m_vStaleMark[3];
+
+    std::vector<STriangleMesh *> m_vMesh;
+    unsigned int m_nState;
+    float m_fStep;
+    unsigned int m_nMaxSubsteps;
+    glm::uint64 m_nStep;
+    float m_fLinearSleep;
+    float m_fAngularSleep;
+    float m_fSleepTime;
+    bool m_bStats;
+    SStepStats m_sStats;
+    std::vector<glm::uint8> m_vIsland;
+
+    //! the physics thread fills m_nBack, the reader holds m_nFront
+    SSnapshot m_sSnapshot[3];
+    std::atomic<unsigned int> m_nReady;
+    unsigned int m_nBack;
+    unsigned int m_nFront;
+
+    //! the last snapshot published came back unread
+    bool m_bDropped;
+
+    float m_fInterpolation;
 };
 
 #endif /* end of include guard: PHYSICSMANAGER_H */
@@ -21,17 +21,23 @@ CSpriteManager::CSpriteManager()
     m_nSpriteBankCount(0),
     m_vBuffer(MAX),
     m_vSize(MAX),
-    m_psTexture(nullptr)
+    m_psTexture(nullptr),
+    m_psAtlas(nullptr),
+    m_bBatching(false)
 {
+    m_sBatchStats.sprites = 0;
+    m_sBatchStats.draws = 0;
+    m_sBatchStats.milliseconds = 0.0;
 }
 
 CSpriteManager::~CSpriteManager()
 {
 }
 
-void CSpriteManager::init()
+void CSpriteManager::init(CTextureManager *texture, CAtlasManager *atlas)
 {
-    m_psTexture = new CTextureManager();
+    m_psTexture = texture;
+    m_psAtlas = atlas;
 
     glGenBuffers(MAX, &m_vBuffer[0]);
 }
@@ -40,272 +46,478 @@ void CSpriteManager::destroy()
 {
     glDeleteBuffers(MAX, &m_vBuffer[0]);
 
-    if (m_psTexture)
-    {
-        delete m_psTexture;
-        m_psTexture = nullptr;
-    }
+    std::vector<SSpriteBank>::const_iterator i = m_vSpriteBank.begin();
+    for (; i != m_vSpriteBank.end(); i++)
+        if (i->texture != CTextureManager::INVALID_HANDLE)
+            m_psTexture->release(i->texture, "sprite");
+
+    m_vSpriteBank.clear();
+    m_vBatchTexture.clear();
+    m_vSprite.clear();
+    m_vSpriteFrame.clear();
+    m_mSpriteHandle.clear();
+
+    m_psTexture = nullptr;
+    m_psAtlas = nullptr;
 }
 
-void CSpriteManager::addToSpriteBank(char const *file)
+unsigned int CSpriteManager::addToSpriteBank(char const *file,
+        CTextureManager::SImagePayload const *payload)
 {
-    if (file != NULL)
+    if (file == NULL)
+        return INVALID_HANDLE;
+
+    //! a .vsb is taken as is, anything else is xml compiled into a .vsb
+    //! beside it on first load and reused while the xml is unchanged
+    std::string path(file);
+    std::string cache(path);
+    bool compiled = path.size() > 4 && path.compare(path.size() - 4, 4, ".vsb") == 0;
+    if (!compiled)
+        cache += ".vsb";
+
+    struct stat source;
+    if (!compiled && stat(file, &source) != 0)
     {
-        pugi::xml_document doc;
-        if (!doc.load_file(file))
-            fprintf(stderr, "[ERR] Sprite Manager Error: Unable to load the file.");
-
-        pugi::xml_node root = doc.child("texture");
-        
-        SSpriteBank bank;
-        pugi::xml_attribute_iterator attr = root.attributes_begin();
-        for (; attr != root.attributes_end(); ++attr)
-        {
-            if (std::string("name").compare(attr->name()) == 0)
-            {
-                bank.name = attr->value();
-            }
-
-            if (std::string("path").compare(attr->name()) == 0)
-            {
-                bank.path = attr->value();
-            }
+        fprintf(stderr, "[ERR] Sprite Manager Error: Unable to load the file.");
+        return INVALID_HANDLE;
+    }
 
-            if (std::string("type").compare(attr->name()) == 0)
-            {
-                bank.type = attr->as_int();
-            }
-        }
+    unsigned int handle = INVALID_HANDLE;
 
-        pugi::xml_node_iterator child = root.begin();
-        for (; child != root.end(); ++child)
+    int fd = open(cache.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
         {
-            if (std::string("sprite").compare(child->name()) == 0)
+            void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
             {
-                SSprite sprite;
-                pugi::xml_attribute_iterator attr = child->attributes_begin();
-                for (; attr != child->attributes_end(); ++attr)
-                {
-                    if (std::string("name").compare(attr->name()) == 0)
-                    {
-                        sprite.name = attr->value();
-                    }
-                }
-
-                pugi::xml_node_iterator it = child->begin();
-                for (; it != child->end(); ++it)
-                {
-                    if (std::string("frame").compare(it->name()) == 0)
-                    {
-                        SSpriteFrame frame;
-                        pugi::xml_attribute_iterator at = it->attributes_begin();
-                        for (; at != it->attributes_end(); ++at)
-                        {
-                            if (std::string("id").compare(at->name()) == 0)
-                            {
-                                frame.id = at->as_int();
-                            }
-
-                            if (std::string("x1").compare(at->name()) == 0)
-                            {
-                                frame.UL.x = at->as_float();
-                            }
-
-                            if (std::string("y1").compare(at->name()) == 0)
-                            {
-                                frame.UL.y = at->as_float();
-                            }
-
-                            if (std::string("x2").compare(at->name()) == 0)
-                            {
-                                frame.LR.x = at->as_float();
-                            }
-
-                            if (std::string("y2").compare(at->name()) == 0)
-                            {
-                                frame.LR.y = at->as_float();
-                            }
-                        }
-
-                        frame.populateDimension();
-                        sprite.frames.push_back(frame);
-                    }
-                }
-
-                m_mSpriteMapToBank[sprite.name] = m_nSpriteBankCount;
-                bank.sprites.push_back(sprite);
-                m_nSpriteCount++;
+                if (validateSpriteBank(static_cast<char const *>(data), info.st_size,
+                            compiled ? nullptr : &source))
+                    handle = registerSpriteBank(static_cast<char const *>(data), payload);
+
+                munmap(data, info.st_size);
             }
         }
 
-        GLenum type = GL_RGB;
-        if (bank.type == 2)
+        close(fd);
+
+        if (handle != INVALID_HANDLE || compiled)
+            return handle;
+    }
+    else if (compiled)
+    {
+        fprintf(stderr, "[ERR] Sprite Manager Error: Unable to load the file.");
+        return INVALID_HANDLE;
+    }
+
+    std::vector<char> image;
+    if (!compileSpriteBank(file, image))
+        return INVALID_HANDLE;
+
+    SBankHeader *header = reinterpret_cast<SBankHeader *>(&image[0]);
+    header->sourceSize = source.st_size;
+    header->sourceTime = source.st_mtime;
+
+    //! a read only asset tree just means compiling again next time
+    FILE *out = fopen(cache.c_str(), "wb");
+    if (out)
+    {
+        if (fwrite(&image[0], 1, image.size(), out) != image.size())
+            fprintf(stderr, "[ERR] Sprite Manager Error: Unable to write %s.", cache.c_str());
+        fclose(out);
+    }
+
+    return registerSpriteBank(&image[0], payload);
+}
+
+bool CSpriteManager::compileSpriteBank(char const *file, std::vector<char> &image)
+{
+    pugi::xml_document doc;
+    if (!doc.load_file(file))
+    {
+        fprintf(stderr, "[ERR] Sprite Manager Error: Unable to load the file.");
+        return false;
+    }
+
+    pugi::xml_node root = doc.child("texture");
+
+    std::vector<SBankSprite> sprites;
+    std::vector<SBankFrame> frames;
+    std::string strings;
+
+    SBankHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "VSB1", 4);
+    header.version = 1;
+    header.type = root.attribute("type").as_uint();
+    header.priority = root.attribute("priority").as_uint();
+
+    header.name = strings.size();
+    strings.append(root.attribute("name").value()).push_back('\0');
+    header.path = strings.size();
+    strings.append(root.attribute("path").value()).push_back('\0');
+
+    pugi::xml_node child = root.child("sprite");
+    for (; child; child = child.next_sibling("sprite"))
+    {
+        SBankSprite sprite;
+        sprite.name = strings.size();
+        sprite.first = frames.size();
+        sprite.count = 0;
+        strings.append(child.attribute("name").value()).push_back('\0');
+
+        pugi::xml_node it = child.child("frame");
+        for (; it; it = it.next_sibling("frame"))
         {
-            type = GL_RGBA;
+            SBankFrame frame;
+            frame.x1 = it.attribute("x1").as_float();
+            frame.y1 = it.attribute("y1").as_float();
+            frame.x2 = it.attribute("x2").as_float();
+            frame.y2 = it.attribute("y2").as_float();
+
+            frames.push_back(frame);
+            sprite.count++;
         }
 
-        m_psTexture->load(bank.path.c_str(), m_nSpriteBankCount, type);
-        m_vSpriteBank.push_back(bank);
-        m_nSpriteBankCount++;
+        sprites.push_back(sprite);
     }
+
+    while (strings.size() % 4)
+        strings.push_back('\0');
+
+    header.spriteCount = sprites.size();
+    header.spriteOffset = sizeof(SBankHeader);
+    header.frameCount = frames.size();
+    header.frameOffset = header.spriteOffset + sprites.size() * sizeof(SBankSprite);
+    header.stringSize = strings.size();
+    header.stringOffset = header.frameOffset + frames.size() * sizeof(SBankFrame);
+
+    image.resize(header.stringOffset + header.stringSize);
+    memcpy(&image[0], &header, sizeof(header));
+    if (!sprites.empty())
+        memcpy(&image[header.spriteOffset], &sprites[0], sprites.size() * sizeof(SBankSprite));
+    if (!frames.empty())
+        memcpy(&image[header.frameOffset], &frames[0], frames.size() * sizeof(SBankFrame));
+    memcpy(&image[header.stringOffset], strings.data(), strings.size());
+
+    return true;
+}
+
+bool CSpriteManager::validateSpriteBank(char const *data, size_t size, struct stat const *source)
+{
+    if (size < sizeof(SBankHeader))
+        return false;
+
+    SBankHeader const *header = reinterpret_cast<SBankHeader const *>(data);
+    if (memcmp(header->magic, "VSB1", 4) != 0 || header->version != 1)
+        return false;
+
+    if (source && (header->sourceSize != glm::uint64(source->st_size) ||
+                header->sourceTime != glm::uint64(source->st_mtime)))
+        return false;
+
+    if (header->spriteOffset + glm::uint64(header->spriteCount) * sizeof(SBankSprite) > size ||
+            header->frameOffset + glm::uint64(header->frameCount) * sizeof(SBankFrame) > size ||
+            header->stringOffset + glm::uint64(header->stringSize) > size ||
+            header->stringSize == 0 || data[header->stringOffset + header->stringSize - 1] != '\0')
+        return false;
+
+    SBankSprite const *sprites = reinterpret_cast<SBankSprite const *>(data + header->spriteOffset);
+    for (glm::uint32 i = 0; i < header->spriteCount; i++)
+        if (sprites[i].name >= header->stringSize ||
+                glm::uint64(sprites[i].first) + sprites[i].count > header->frameCount)
+            return false;
+
+    return header->name < header->stringSize && header->path < header->stringSize;
 }
 
-void CSpriteManager::renderSprite(char const *name, glm::vec2 pos)
+unsigned int CSpriteManager::registerSpriteBank(char const *data,
+        CTextureManager::SImagePayload const *payload)
 {
-    if (name != NULL)
+    SBankHeader const *header = reinterpret_cast<SBankHeader const *>(data);
+    SBankSprite const *sprites = reinterpret_cast<SBankSprite const *>(data + header->spriteOffset);
+    SBankFrame const *frames = reinterpret_cast<SBankFrame const *>(data + header->frameOffset);
+    char const *strings = data + header->stringOffset;
+
+    SSpriteBank bank;
+    bank.name = strings + header->name;
+    bank.path = strings + header->path;
+    bank.type = header->type;
+    bank.priority = header->priority;
+    bank.first = m_vSprite.size();
+    bank.count = header->spriteCount;
+
+    GLenum type = GL_RGB;
+    if (bank.type == 2)
     {
-        if (m_mSpriteMapToBank.find(name) != m_mSpriteMapToBank.end())
-        {
-            unsigned int id = m_mSpriteMapToBank[name];
-            SSpriteBank const &bank = m_vSpriteBank[id];
+        type = GL_RGBA;
+    }
 
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBlendColor(1.0, 1.0, 1.0, 1.0);
-            
-            m_psTexture->bindTexture(id);
+    //! small banks go into the shared atlas so sprites from different
+    //! banks end up in the same draw, the rest keep a texture of their own
+    unsigned int region = CAtlasManager::INVALID_HANDLE;
+    if (m_psAtlas)
+        region = payload ? m_psAtlas->add(*payload) : m_psAtlas->add(bank.path.c_str());
 
-            SSpriteFrame const *frame = &bank.sprites[0].frames[0];
-            float w = frame->dimension.x;
-            float h = frame->dimension.y;
+    bank.texture = CTextureManager::INVALID_HANDLE;
 
-            float s = m_psTexture->getImageProperties(id).width;
-            float t = m_psTexture->getImageProperties(id).height;
+    unsigned int texture = 0;
+    glm::vec2 origin(0.0, 0.0);
+    glm::vec2 extent(1.0, 1.0);
+    float s = 1.0;
+    float t = 1.0;
 
-            glm::vec2 UL(frame->UL.x / s, (t - frame->UL.y) / t);
-            glm::vec2 LR(frame->LR.x / s, (t - frame->LR.y) / t);
+    if (region != CAtlasManager::INVALID_HANDLE)
+    {
+        CAtlasManager::SAtlasRegion const &r = m_psAtlas->getRegion(region);
+        texture = ATLAS_PAGE | r.page;
+        origin = r.UL;
+        extent = r.LR - r.UL;
+        s = r.dimension.x;
+        t = r.dimension.y;
+    }
+    else
+    {
+        if (payload)
+            bank.texture = m_psTexture->acquire(*payload, bank.path.c_str(), "sprite", type);
+        else
+            bank.texture = m_psTexture->acquire(bank.path.c_str(), "sprite", type, type);
+        texture = std::find(m_vBatchTexture.begin(), m_vBatchTexture.end(), bank.texture) - m_vBatchTexture.begin();
+        if (texture == m_vBatchTexture.size())
+            m_vBatchTexture.push_back(bank.texture);
+
+        CTextureManager::SImageProperties image = m_psTexture->getHandleProperties(bank.texture);
+        s = image.width ? image.width : 1.0;
+        t = image.height ? image.height : 1.0;
+    }
 
-            helpers::SVertv2v2 vertexData[4] = 
-            {
-                helpers::SVertv2v2(glm::vec2(pos.x, pos.y), glm::vec2(UL.x, UL.y)),
-                helpers::SVertv2v2(glm::vec2(pos.x, pos.y + h), glm::vec2(UL.x, LR.y)),
-                helpers::SVertv2v2(glm::vec2(pos.x + w, pos.y + h), glm::vec2(LR.x, LR.y)),
-                helpers::SVertv2v2(glm::vec2(pos.x + w, pos.y), glm::vec2(LR.x, UL.y))
-            };
+    size_t base = m_vSpriteFrame.size();
+    m_vSpriteFrame.reserve(base + header->frameCount);
+    for (glm::uint32 i = 0; i < header->frameCount; i++)
+    {
+        SSpriteFrame frame;
+        frame.UL = origin + glm::vec2(frames[i].x1 / s, (t - frames[i].y1) / t) * extent;
+        frame.LR = origin + glm::vec2(frames[i].x2 / s, (t - frames[i].y2) / t) * extent;
+        frame.dimension = glm::vec2(frames[i].x2 - frames[i].x1, frames[i].y2 - frames[i].y1);
+        m_vSpriteFrame.push_back(frame);
+    }
 
-            GLsizei const vertexCount = 4;
-            GLsizeiptr const vertexSize = vertexCount * sizeof(helpers::SVertv2v2);
+    m_vSprite.reserve(m_vSprite.size() + header->spriteCount);
+    for (glm::uint32 i = 0; i < header->spriteCount; i++)
+    {
+        SSprite sprite;
+        sprite.texture = texture;
+        sprite.first = base + sprites[i].first;
+        sprite.count = sprites[i].count;
+
+        m_mSpriteHandle[strings + sprites[i].name] = m_vSprite.size();
+        m_vSprite.push_back(sprite);
+        m_nSpriteCount++;
+    }
 
-            GLsizei const elementCount = 4;
-            GLsizeiptr const elementSize = elementCount * sizeof(glm::uint32);
-            glm::uint32 elementData[] = { 0, 1, 2, 3 };
+    m_vSpriteBank.push_back(bank);
+    m_nSpriteBankCount++;
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
-            if (vertexSize != m_vSize[VERTEX])
-            {
-                glBufferData(GL_ARRAY_BUFFER, vertexSize, vertexData, GL_DYNAMIC_DRAW);
-                m_vSize[VERTEX] = vertexSize;
-            }
-            else
-                glBufferSubData(GL_ARRAY_BUFFER, 0, vertexSize, vertexData);
+    if (bank.count == 0)
+        return INVALID_HANDLE;
 
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return bank.first;
+}
 
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
-            if (elementSize != m_vSize[ELEMENT])
-            {
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, elementData, GL_DYNAMIC_DRAW);
-                m_vSize[ELEMENT] = elementSize;
-            }
-            else
-                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, elementSize, elementData);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-            glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
-            glVertexAttribPointer(helpers::semantic::attr::POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(0));
-            glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(sizeof(glm::vec2)));
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
-            glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
-            glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
-                glDrawElements(GL_TRIANGLE_FAN, elementCount, GL_UNSIGNED_INT, 0);
-            glDisableVertexAttribArray(helpers::semantic::attr::POSITION);
-            glDisableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-            
-            glDisable(GL_BLEND);
-        }
+unsigned int CSpriteManager::getSpriteHandle(char const *name) const
+{
+    if (name == NULL)
+        return INVALID_HANDLE;
+
+    std::map<std::string, unsigned int>::const_iterator i = m_mSpriteHandle.find(name);
+    if (i == m_mSpriteHandle.end())
+        return INVALID_HANDLE;
+
+    return i->second;
+}
+
+unsigned int CSpriteManager::getFrameCount(unsigned int handle) const
+{
+    if (handle >= m_vSprite.size())
+        return 0;
+
+    return m_vSprite[handle].count;
+}
+
+void CSpriteManager::begin()
+{
+    m_vBatchItem.clear();
+    m_vBatchQuad.clear();
+
+    m_sBatchStats.sprites = 0;
+    m_sBatchStats.draws = 0;
+    m_sBatchStats.milliseconds = 0.0;
+
+    m_bBatching = true;
+}
+
+void CSpriteManager::submit(unsigned int handle, unsigned int index, glm::vec2 pos, EBlendMode blend)
+{
+    if (!m_bBatching || handle >= m_vSprite.size())
+        return;
+
+    SSprite const &sprite = m_vSprite[handle];
+    if (index >= sprite.count)
+        return;
+
+    SSpriteFrame const &frame = m_vSpriteFrame[sprite.first + index];
+    float w = frame.dimension.x;
+    float h = frame.dimension.y;
+
+    SBatchItem item;
+    item.key = (glm::uint64((blend << 24) | (sprite.texture & 0xFFFFFF)) << 32) | m_vBatchItem.size();
+    item.quad = m_vBatchQuad.size();
+    m_vBatchItem.push_back(item);
+
+    m_vBatchQuad.push_back(helpers::SVertv2v2(glm::vec2(pos.x, pos.y), glm::vec2(frame.UL.x, frame.UL.y)));
+    m_vBatchQuad.push_back(helpers::SVertv2v2(glm::vec2(pos.x, pos.y + h), glm::vec2(frame.UL.x, frame.LR.y)));
+    m_vBatchQuad.push_back(helpers::SVertv2v2(glm::vec2(pos.x + w, pos.y + h), glm::vec2(frame.LR.x, frame.LR.y)));
+    m_vBatchQuad.push_back(helpers::SVertv2v2(glm::vec2(pos.x + w, pos.y), glm::vec2(frame.LR.x, frame.UL.y)));
+}
+
+void CSpriteManager::submitByName(char const *name, unsigned int index, glm::vec2 pos, EBlendMode blend)
+{
+    submit(getSpriteHandle(name), index, pos, blend);
+}
+
+void CSpriteManager::end()
+{
+    if (!m_bBatching)
+        return;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    flush();
+    Uint64 stop = SDL_GetPerformanceCounter();
+
+    m_sBatchStats.sprites = m_vBatchItem.size();
+    m_sBatchStats.milliseconds = float(stop - start) * 1000.0 / float(SDL_GetPerformanceFrequency());
+
+    m_bBatching = false;
+}
+
+void CSpriteManager::renderSprite(unsigned int handle, unsigned int index, glm::vec2 pos)
+{
+    //! outside of begin/end a single sprite is its own batch
+    if (m_bBatching)
+        submit(handle, index, pos);
+    else
+    {
+        begin();
+        submit(handle, index, pos);
+        end();
     }
 }
 
-void CSpriteManager::renderSprite(char const *name, unsigned int index, glm::vec2 pos)
+void CSpriteManager::renderSpriteByName(char const *name, glm::vec2 pos)
 {
-    if (name != NULL)
+    renderSprite(getSpriteHandle(name), 0, pos);
+}
+
+void CSpriteManager::renderSpriteByName(char const *name, unsigned int index, glm::vec2 pos)
+{
+    renderSprite(getSpriteHandle(name), index, pos);
+}
+
+void CSpriteManager::flush()
+{
+    if (m_vBatchItem.empty())
+        return;
+
+    std::sort(m_vBatchItem.begin(), m_vBatchItem.end());
+
+    //! lay the quads out in sorted order so each (blend, texture) run is one
+    //! contiguous range of the element buffer
+    m_vBatchVertex.clear();
+    m_vBatchVertex.reserve(m_vBatchQuad.size());
+    std::vector<SBatchItem>::const_iterator it = m_vBatchItem.begin();
+    for (; it != m_vBatchItem.end(); it++)
+        m_vBatchVertex.insert(m_vBatchVertex.end(),
+                m_vBatchQuad.begin() + it->quad,
+                m_vBatchQuad.begin() + it->quad + 4);
+
+    size_t quadCount = m_vBatchItem.size();
+    if (m_vBatchElement.size() < quadCount * 6)
     {
-        if (m_mSpriteMapToBank.find(name) != m_mSpriteMapToBank.end())
+        size_t capacity = std::max(quadCount, m_vBatchElement.size() / 3);
+        m_vBatchElement.clear();
+        m_vBatchElement.reserve(capacity * 6);
+        for (size_t q = 0; q < capacity; q++)
         {
-            unsigned int id = m_mSpriteMapToBank[name];
-            SSpriteBank const &bank = m_vSpriteBank[id];
+            glm::uint32 base = q * 4;
+            glm::uint32 quad[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            m_vBatchElement.insert(m_vBatchElement.end(), quad, quad + 6);
+        }
 
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBlendColor(1.0, 1.0, 1.0, 1.0);
-            
-            m_psTexture->bindTexture(id);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_vBatchElement.size() * sizeof(glm::uint32), &m_vBatchElement[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
 
-            SSpriteFrame const *frame = &bank.sprites[0].frames[index];
-            float w = frame->dimension.x;
-            float h = frame->dimension.y;
+    //! stream the vertices, orphaning the previous storage so the driver
+    //! never waits on last frame's draws
+    GLsizeiptr const vertexSize = m_vBatchVertex.size() * sizeof(helpers::SVertv2v2);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
+    if (size_t(vertexSize) > m_vSize[VERTEX])
+        m_vSize[VERTEX] = std::max(size_t(vertexSize), m_vSize[VERTEX] * 2);
+    glBufferData(GL_ARRAY_BUFFER, m_vSize[VERTEX], NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertexSize, &m_vBatchVertex[0]);
 
-            float s = m_psTexture->getImageProperties(id).width;
-            float t = m_psTexture->getImageProperties(id).height;
+    glVertexAttribPointer(helpers::semantic::attr::POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(0));
+    glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(sizeof(glm::vec2)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-            glm::vec2 UL(frame->UL.x / s, (t - frame->UL.y) / t);
-            glm::vec2 LR(frame->LR.x / s, (t - frame->LR.y) / t);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
+    glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
+    glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
 
-            helpers::SVertv2v2 vertexData[4] = 
-            {
-                helpers::SVertv2v2(glm::vec2(pos.x, pos.y), glm::vec2(UL.x, UL.y)),
-                helpers::SVertv2v2(glm::vec2(pos.x, pos.y + h), glm::vec2(UL.x, LR.y)),
-                helpers::SVertv2v2(glm::vec2(pos.x + w, pos.y + h), glm::vec2(LR.x, LR.y)),
-                helpers::SVertv2v2(glm::vec2(pos.x + w, pos.y), glm::vec2(LR.x, UL.y))
-            };
+    glBlendColor(1.0, 1.0, 1.0, 1.0);
 
-            GLsizei const vertexCount = 4;
-            GLsizeiptr const vertexSize = vertexCount * sizeof(helpers::SVertv2v2);
+    size_t first = 0;
+    while (first < quadCount)
+    {
+        glm::uint32 group = m_vBatchItem[first].key >> 32;
 
-            GLsizei const elementCount = 4;
-            GLsizeiptr const elementSize = elementCount * sizeof(glm::uint32);
-            glm::uint32 elementData[] = { 0, 1, 2, 3 };
+        size_t last = first + 1;
+        while (last < quadCount && (m_vBatchItem[last].key >> 32) == group)
+            last++;
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
-            if (vertexSize != m_vSize[VERTEX])
-            {
-                glBufferData(GL_ARRAY_BUFFER, vertexSize, vertexData, GL_DYNAMIC_DRAW);
-                m_vSize[VERTEX] = vertexSize;
-            }
-            else
-                glBufferSubData(GL_ARRAY_BUFFER, 0, vertexSize, vertexData);
+        switch (group >> 24)
+        {
+            case E_BM_NONE:
+                glDisable(GL_BLEND);
+                break;
+            case E_BM_ALPHA:
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+            case E_BM_ADDITIVE:
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+                break;
+        }
 
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (group & ATLAS_PAGE)
+            m_psAtlas->bindPage(group & (ATLAS_PAGE - 1));
+        else
+            m_psTexture->bindHandle(m_vBatchTexture[group & 0xFFFFFF]);
 
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
-            if (elementSize != m_vSize[ELEMENT])
-            {
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementSize, elementData, GL_DYNAMIC_DRAW);
-                m_vSize[ELEMENT] = elementSize;
-            }
-            else
-                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, elementSize, elementData);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-            glBindBuffer(GL_ARRAY_BUFFER, m_vBuffer[VERTEX]);
-            glVertexAttribPointer(helpers::semantic::attr::POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(0));
-            glVertexAttribPointer(helpers::semantic::attr::TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(helpers::SVertv2v2), BUFFER_OFFSET(sizeof(glm::vec2)));
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vBuffer[ELEMENT]);
-            glEnableVertexAttribArray(helpers::semantic::attr::POSITION);
-            glEnableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
-                glDrawElements(GL_TRIANGLE_FAN, elementCount, GL_UNSIGNED_INT, 0);
-            glDisableVertexAttribArray(helpers::semantic::attr::POSITION);
-            glDisableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-            
-            glDisable(GL_BLEND);
-        }
+        glDrawElements(GL_TRIANGLES, (last - first) * 6, GL_UNSIGNED_INT,
+                BUFFER_OFFSET(first * 6 * sizeof(glm::uint32)));
+        m_sBatchStats.draws++;
+
+        first = last;
     }
+
+    glDisableVertexAttribArray(helpers::semantic::attr::POSITION);
+    glDisableVertexAttribArray(helpers::semantic::attr::TEXCOORD);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glDisable(GL_BLEND);
 }
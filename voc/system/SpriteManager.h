@@ -22,6 +22,7 @@
 #include "../utils/Helpers.h"
 
 #include "TextureManager.h"
+#include "AtlasManager.h"
 
 class CSpriteManager
 {
@@ -29,30 +30,70 @@ public:
     explicit CSpriteManager();
     ~CSpriteManager();
 
-    void init();
+    enum EBlendMode
+    {
+        E_BM_NONE = 0,
+        E_BM_ALPHA,
+        E_BM_ADDITIVE,
+
+        E_BM_MAX
+    };
+
+    struct SBatchStats
+    {
+        unsigned int sprites;
+        unsigned int draws;
+        float milliseconds;
+    };
+
+    static const unsigned int INVALID_HANDLE = 0xFFFFFFFF;
+
+    void init(CTextureManager *texture, CAtlasManager *atlas = nullptr);
     void destroy();
 
-    void addToSpriteBank(char const *file);
+    unsigned int addToSpriteBank(char const *file,
+            CTextureManager::SImagePayload const *payload = nullptr);
+    unsigned int getSpriteHandle(char const *name) const;
+    unsigned int getFrameCount(unsigned int handle) const;
+
+    void begin();
+    void submit(unsigned int handle, unsigned int index, glm::vec2 pos, EBlendMode blend = E_BM_ALPHA);
+    void end();
+
+    void renderSprite(unsigned int handle, unsigned int index, glm::vec2 pos);
 
-    void renderSprite(char const *name, glm::vec2 pos);
-    void renderSprite(char const *name, unsigned int index, glm::vec2 pos);
+    //! look the name up on every call; named apart from the handle calls
+    //! so a literal 0 never picks the wrong one
+    void submitByName(char const *name, unsigned int index, glm::vec2 pos, EBlendMode blend = E_BM_ALPHA);
+    void renderSpriteByName(char const *name, glm::vec2 pos);
+    void renderSpriteByName(char const *name, unsigned int index, glm::vec2 pos);
+
+    SBatchStats const &getBatchStats() const { return m_sBatchStats; }
 
 private:
+    //! frames of every bank live in one array with UVs normalized against
+    //! the bank texture (or its atlas region) at load, a sprite handle
+    //! indexes m_vSprite and the render path never touches a string
     struct SSpriteFrame
     {
-        unsigned int id;
-
         glm::vec2 UL;
         glm::vec2 LR;
 
         glm::vec2 dimension;
-        void populateDimension() { dimension = glm::vec2(LR - UL); }
+    };
+
+    //! a sprite's texture is either an index into m_vBatchTexture or,
+    //! flagged with ATLAS_PAGE, an atlas page
+    enum
+    {
+        ATLAS_PAGE = 0x800000
     };
 
     struct SSprite
     {
-        std::string name;
-        std::vector<SSpriteFrame> frames;
+        unsigned int texture;
+        unsigned int first;
+        unsigned int count;
     };
 
     struct SSpriteBank
@@ -63,11 +104,63 @@ private:
         unsigned int priority;
         unsigned int type;
 
-        std::vector<SSprite> sprites;
+        unsigned int first;
+        unsigned int count;
+
+        unsigned int texture;
     };
-    
+
+    //! compiled bank layout, read in place from an mmap: header, sprite
+    //! records, frame records and a string table of nul terminated names;
+    //! every offset is in bytes from the start of the file
+    struct SBankHeader
+    {
+        char magic[4];
+        glm::uint32 version;
+
+        glm::uint64 sourceSize;
+        glm::uint64 sourceTime;
+
+        glm::uint32 type;
+        glm::uint32 priority;
+        glm::uint32 name;
+        glm::uint32 path;
+
+        glm::uint32 spriteCount;
+        glm::uint32 spriteOffset;
+        glm::uint32 frameCount;
+        glm::uint32 frameOffset;
+        glm::uint32 stringSize;
+        glm::uint32 stringOffset;
+    };
+
+    struct SBankSprite
+    {
+        glm::uint32 name;
+        glm::uint32 first;
+        glm::uint32 count;
+    };
+
+    struct SBankFrame
+    {
+        float x1;
+        float y1;
+        float x2;
+        float y2;
+    };
+
+    bool compileSpriteBank(char const *file, std::vector<char> &image);
+    bool validateSpriteBank(char const *data, size_t size, struct stat const *source);
+    unsigned int registerSpriteBank(char const *data,
+            CTextureManager::SImagePayload const *payload);
+
+    std::vector<SSpriteFrame> m_vSpriteFrame;
+    std::vector<SSprite> m_vSprite;
     std::vector<SSpriteBank> m_vSpriteBank;
-    std::map<std::string, unsigned int> m_mSpriteMapToBank;
+
+    //! distinct texture handles of the banks, so banks sharing one batch
+    std::vector<unsigned int> m_vBatchTexture;
+    std::map<std::string, unsigned int> m_mSpriteHandle;
 
     unsigned int m_nSpriteCount;
     unsigned int m_nSpriteBankCount;
@@ -84,6 +177,27 @@ private:
     std::vector<size_t> m_vSize;
 
     CTextureManager *m_psTexture;
+    CAtlasManager *m_psAtlas;
+
+    //! (blend mode, texture) in the high word and submission order in the low
+    //! word, so sorting groups draws while keeping submission order stable
+    struct SBatchItem
+    {
+        glm::uint64 key;
+        glm::uint32 quad;
+
+        bool operator<(SBatchItem const &other) const { return key < other.key; }
+    };
+
+    void flush();
+
+    std::vector<SBatchItem> m_vBatchItem;
+    std::vector<helpers::SVertv2v2> m_vBatchQuad;
+    std::vector<helpers::SVertv2v2> m_vBatchVertex;
+    std::vector<glm::uint32> m_vBatchElement;
+
+    bool m_bBatching;
+    SBatchStats m_sBatchStats;
 };
 
 #endif /* end of include guard: SPRITEMANAGER_H */
@@ -16,14 +16,340 @@
  */
 
 #include "TextureManager.h"
+#include "../utils/Helpers.h"
+#include "../utils/ImageKernels.h"
+#include "../utils/TextureCodec.h"
+
+//! every decoded image leaves as bottom up RGBA8 whatever the source
+//! held, so uploads match what drivers store natively and the format a
+//! caller guessed no longer matters; takes ownership of dib
+static FIBITMAP *expand(FIBITMAP *dib)
+{
+    //! plain 24 bit images, most of what gets loaded, are widened and
+    //! swizzled in one pass; anything else goes through FreeImage first
+    if (FreeImage_GetImageType(dib) == FIT_BITMAP && FreeImage_GetBPP(dib) == 24)
+    {
+        unsigned int width = FreeImage_GetWidth(dib);
+        unsigned int height = FreeImage_GetHeight(dib);
+
+        FIBITMAP *converted = FreeImage_Allocate(width, height, 32);
+        if (converted)
+            kernels::expandRGB(FreeImage_GetBits(dib), width, height, FreeImage_GetPitch(dib),
+                    FreeImage_GetBits(converted), FreeImage_GetPitch(converted), FI_RGBA_RED != 0);
+
+        FreeImage_Unload(dib);
+        return converted;
+    }
+
+    FIBITMAP *converted = FreeImage_ConvertTo32Bits(dib);
+    FreeImage_Unload(dib);
+
+    if (converted && FI_RGBA_RED != 0)
+        kernels::swizzleRB(FreeImage_GetBits(converted), FreeImage_GetWidth(converted),
+                FreeImage_GetHeight(converted), FreeImage_GetPitch(converted));
+
+    return converted;
+}
+
+static std::string canonicalPath(const char *filename)
+{
+    char resolved[PATH_MAX];
+    if (realpath(filename, resolved))
+        return resolved;
+
+    return filename;
+}
+
+static size_t getTextureBytes(GLint internalFormat, unsigned int width, unsigned int height)
+{
+    size_t components = 4;
+    switch (internalFormat)
+    {
+        case GL_RED:
+        case GL_R8:
+            components = 1;
+            break;
+        case GL_RG:
+        case GL_RG8:
+            components = 2;
+            break;
+    }
+
+    //! drivers pad RGB out to four bytes, so it is charged as RGBA
+    return size_t(width) * height * components;
+}
+
+//! a compiled container next to the source image wins as long as it is
+//! not older than the image, a .vtc path is always taken as is
+static std::string findContainer(const char *filename)
+{
+    size_t length = strlen(filename);
+    if (length > 4 && strcmp(filename + length - 4, ".vtc") == 0)
+        return filename;
+
+    std::string container = std::string(filename) + ".vtc";
+
+    struct stat source, compiled;
+    if (stat(container.c_str(), &compiled) != 0)
+        return std::string();
+
+    if (stat(filename, &source) == 0 && source.st_mtime > compiled.st_mtime)
+        return std::string();
+
+    return container;
+}
 
 CTextureManager::CTextureManager()
+    : m_psDecodePool(nullptr),
+    m_nPlaceholder(0),
+    m_nUnpackIndex(0),
+    m_nUploadBudget(4 * 1024 * 1024),
+    m_nFrame(0)
 {
+    for (int i = 0; i < UNPACK_BUFFERS; i++)
+        m_vUnpackBuffer[i] = 0;
 }
 
 CTextureManager::~CTextureManager()
 {
+    if (m_psDecodePool)
+    {
+        m_psDecodePool->wait();
+
+        delete m_psDecodePool;
+        m_psDecodePool = nullptr;
+    }
+
+    m_vStreaming.insert(m_vStreaming.end(), m_vDecoded.begin(), m_vDecoded.end());
+    m_vDecoded.clear();
+
+    std::vector<SUploadJob *>::iterator j = m_vStreaming.begin();
+    for (; j != m_vStreaming.end(); j++)
+        discard(*j);
+    m_vStreaming.clear();
+
+    if (m_vUnpackBuffer[0])
+        glDeleteBuffers(UNPACK_BUFFERS, m_vUnpackBuffer);
+
     unloadAllTextures();
+
+    while (!m_sTexture.empty())
+        destroyTexture(m_sTexture.getHandle(m_sTexture.size() - 1));
+
+    if (m_nPlaceholder)
+        glDeleteTextures(1, &m_nPlaceholder);
+}
+
+unsigned int CTextureManager::acquire(const char *filename, const char *owner,
+        GLenum imageFormat,
+        GLint internalFormat,
+        GLint level,
+        GLint border)
+{
+    if (filename == NULL)
+        return INVALID_HANDLE;
+
+    //! the image format is left out, every file is uploaded as RGBA
+    char parameters[64];
+    snprintf(parameters, sizeof(parameters), "#%x:%d:%d", internalFormat, level, border);
+    std::string key = canonicalPath(filename) + parameters;
+
+    unsigned int handle = findCached(key, owner);
+    if (handle != INVALID_HANDLE)
+        return handle;
+
+    handle = insert(key, owner);
+
+    STexture &texture = *m_sTexture.get(handle);
+    setSource(texture, filename, imageFormat, internalFormat, level, border);
+
+    if (!loadFile(texture))
+    {
+        destroyTexture(handle);
+        return INVALID_HANDLE;
+    }
+
+    enforceBudget();
+    return handle;
+}
+
+unsigned int CTextureManager::acquire(SImagePayload const &payload, const char *name,
+        const char *owner, GLint internalFormat)
+{
+    if ((name == NULL) || (payload.pixels == 0) || (payload.width == 0) || (payload.height == 0))
+        return INVALID_HANDLE;
+
+    //! payloads have no file behind them, the caller's name is the key
+    char parameters[64];
+    snprintf(parameters, sizeof(parameters), "#%x:%x:0:0", payload.format, internalFormat);
+    std::string key = std::string("payload:") + name + parameters;
+
+    unsigned int handle = findCached(key, owner);
+    if (handle != INVALID_HANDLE)
+        return handle;
+
+    handle = insert(key, owner);
+    upload(*m_sTexture.get(handle), payload.pixels, payload.width, payload.height,
+            payload.format, internalFormat, 0, 0);
+
+    enforceBudget();
+    return handle;
+}
+
+void CTextureManager::release(const unsigned int handle, const char *owner)
+{
+    STexture *texture = m_sTexture.get(handle);
+    if (!texture)
+        return;
+
+    std::map<unsigned int, unsigned int>::iterator i = texture->owners.find(getOwner(owner));
+    if (i != texture->owners.end() && --(i->second) == 0)
+        texture->owners.erase(i);
+
+    if (--texture->references == 0)
+        destroyTexture(handle);
+}
+
+unsigned int CTextureManager::acquireAsync(const char *filename, const char *owner,
+        GLenum imageFormat,
+        GLint internalFormat)
+{
+    if (filename == NULL)
+        return INVALID_HANDLE;
+
+    char parameters[64];
+    snprintf(parameters, sizeof(parameters), "#%x:%d:%d", internalFormat, 0, 0);
+    std::string key = canonicalPath(filename) + parameters;
+
+    unsigned int handle = findCached(key, owner);
+    if (handle != INVALID_HANDLE)
+        return handle;
+
+    //! containers need no decode, mapping them in place is cheap enough
+    //! to do right here
+    std::string container = findContainer(filename);
+    if (!container.empty())
+    {
+        handle = insert(key, owner);
+
+        STexture &texture = *m_sTexture.get(handle);
+        setSource(texture, filename, imageFormat, internalFormat, 0, 0);
+
+        if (loadContainer(texture, container))
+        {
+            enforceBudget();
+            return handle;
+        }
+
+        destroyTexture(handle);
+    }
+
+    handle = insert(key, owner);
+    STexture &texture = *m_sTexture.get(handle);
+    setSource(texture, filename, imageFormat, internalFormat, 0, 0);
+
+    queueDecode(handle, texture);
+    return handle;
+}
+
+bool CTextureManager::isResident(const unsigned int handle) const
+{
+    STexture const *texture = m_sTexture.get(handle);
+    return texture && !texture->pending;
+}
+
+void CTextureManager::update()
+{
+    m_nFrame++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_sDecodeMutex);
+        m_vStreaming.insert(m_vStreaming.end(), m_vDecoded.begin(), m_vDecoded.end());
+        m_vDecoded.clear();
+    }
+
+    size_t budget = m_nUploadBudget;
+    std::vector<SUploadJob *>::iterator i = m_vStreaming.begin();
+    while (i != m_vStreaming.end())
+    {
+        SUploadJob *job = *i;
+
+        bool stale = !m_sTexture.contains(job->handle);
+
+        if (stale || !job->dib)
+        {
+            //! the placeholder is shared, the texture must not keep it
+            if (!stale)
+            {
+                fprintf(stderr, "[ERR] Texture Manager Error: Unable to decode %s.", job->filename.c_str());
+                STexture &texture = *m_sTexture.get(job->handle);
+                texture.name = 0;
+                texture.pending = false;
+            }
+
+            discard(job);
+            i = m_vStreaming.erase(i);
+            continue;
+        }
+
+        if (budget == 0)
+            break;
+
+        if (!stream(*job, budget))
+            break;
+
+        //! fully uploaded, swap it in for the placeholder in one step
+        STexture &texture = *m_sTexture.get(job->handle);
+        texture.name = job->name;
+        texture.pending = false;
+        texture.properties.width = FreeImage_GetWidth(job->dib);
+        texture.properties.height = FreeImage_GetHeight(job->dib);
+        charge(texture, getTextureBytes(job->internalFormat,
+                    texture.properties.width, texture.properties.height));
+
+        job->name = 0;
+        discard(job);
+        i = m_vStreaming.erase(i);
+    }
+
+    enforceBudget();
+}
+
+bool CTextureManager::bindHandle(const unsigned int handle)
+{
+    STexture *found = m_sTexture.get(handle);
+    if (!found)
+        return false;
+
+    STexture &texture = *found;
+    texture.lastUsed = m_nFrame;
+
+    //! an evicted texture comes back the way acquireAsync() brings one
+    //! in, the placeholder stands in until the decode has streamed up;
+    //! only a container, which needs no decode, is mapped in right away
+    if (texture.evicted)
+    {
+        texture.evicted = false;
+        m_sBudget.reloads++;
+
+        std::string container = findContainer(texture.source.c_str());
+        if (container.empty() || !loadContainer(texture, container))
+            queueDecode(handle, texture);
+
+        enforceBudget();
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture.name);
+    return true;
+}
+
+CTextureManager::SImageProperties CTextureManager::getHandleProperties(const unsigned int handle) const
+{
+    STexture const *texture = m_sTexture.get(handle);
+    if (!texture)
+        return SImageProperties();
+
+    return texture->properties;
 }
 
 bool CTextureManager::load(const char *filename, const unsigned int textureId,
@@ -32,12 +358,233 @@ bool CTextureManager::load(const char *filename, const unsigned int textureId,
         GLint level,
         GLint border)
 {
+    unsigned int handle = acquire(filename, "default", imageFormat, internalFormat, level, border);
+    if (handle == INVALID_HANDLE)
+        return false;
+
+    unloadTexture(textureId);
+    m_mTextureId[textureId] = handle;
+    return true;
+}
+
+bool CTextureManager::load(SImagePayload const &payload, const unsigned int textureId,
+        GLint internalFormat)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "id:%u", textureId);
+
+    //! the id names the payload, so drop the old contents before looking
+    //! the key up again
+    unloadTexture(textureId);
+
+    unsigned int handle = acquire(payload, name, "default", internalFormat);
+    if (handle == INVALID_HANDLE)
+        return false;
+
+    m_mTextureId[textureId] = handle;
+    return true;
+}
+
+bool CTextureManager::loadAsync(const char *filename, const unsigned int textureId,
+        GLenum imageFormat,
+        GLint internalFormat)
+{
+    unsigned int handle = acquireAsync(filename, "default", imageFormat, internalFormat);
+    if (handle == INVALID_HANDLE)
+        return false;
+
+    unloadTexture(textureId);
+    m_mTextureId[textureId] = handle;
+    return true;
+}
+
+bool CTextureManager::unloadTexture(const unsigned int textureId)
+{
+    bool result = true;
+
+    std::map<unsigned int, unsigned int>::iterator i = m_mTextureId.find(textureId);
+    if (i != m_mTextureId.end())
+    {
+        release(i->second, "default");
+        m_mTextureId.erase(i);
+    }
+    else
+        result = false;
+
+    return result;
+}
+
+bool CTextureManager::bindTexture(const unsigned int textureId)
+{
+    bool result = true;
+
+    std::map<unsigned int, unsigned int>::const_iterator i = m_mTextureId.find(textureId);
+    if (i != m_mTextureId.end())
+        bindHandle(i->second);
+    else
+        result = false;
+
+    return result;
+}
+
+void CTextureManager::unloadAllTextures()
+{
+    std::map<unsigned int, unsigned int>::iterator i = m_mTextureId.begin();
+
+    for (; i != m_mTextureId.end(); i++)
+        release(i->second, "default");
+
+    m_mTextureId.clear();
+}
+
+CTextureManager::SImageProperties CTextureManager::getImageProperties(const unsigned int textureId) const
+{
+    std::map<unsigned int, unsigned int>::const_iterator i = m_mTextureId.find(textureId);
+    if (i != m_mTextureId.end())
+        return getHandleProperties(i->second);
+
+    return SImageProperties();
+}
+
+CTextureManager::SResidency CTextureManager::getResidency() const
+{
+    SResidency residency;
+
+    STexture const *i = m_sTexture.begin();
+    for (; i != m_sTexture.end(); i++)
+    {
+        residency.count++;
+        residency.bytes += i->bytes;
+    }
+
+    return residency;
+}
+
+CTextureManager::SResidency CTextureManager::getResidency(const char *owner) const
+{
+    SResidency residency;
+
+    std::vector<std::string>::const_iterator found = std::find(m_vOwner.begin(), m_vOwner.end(), owner);
+    if (found == m_vOwner.end())
+        return residency;
+
+    //! shared textures are charged in full to every owner holding them
+    unsigned int index = found - m_vOwner.begin();
+    STexture const *i = m_sTexture.begin();
+    for (; i != m_sTexture.end(); i++)
+    {
+        if (i->owners.find(index) != i->owners.end())
+        {
+            residency.count++;
+            residency.bytes += i->bytes;
+        }
+    }
+
+    return residency;
+}
+
+void CTextureManager::setBudget(size_t bytes)
+{
+    m_sBudget.budget = bytes;
+    enforceBudget();
+}
+
+unsigned int CTextureManager::findCached(std::string const &key, const char *owner)
+{
+    std::map<std::string, unsigned int>::const_iterator i = m_mTextureCache.find(key);
+    if (i == m_mTextureCache.end())
+        return INVALID_HANDLE;
+
+    STexture &texture = *m_sTexture.get(i->second);
+    texture.references++;
+    texture.owners[getOwner(owner)]++;
+
+    return i->second;
+}
+
+unsigned int CTextureManager::insert(std::string const &key, const char *owner)
+{
+    unsigned int handle = m_sTexture.insert(STexture());
+
+    STexture &texture = *m_sTexture.get(handle);
+    texture.key = key;
+    texture.pending = false;
+    texture.source.clear();
+    texture.lastUsed = m_nFrame;
+    texture.evicted = false;
+    texture.name = 0;
+    texture.bytes = 0;
+    texture.properties = SImageProperties();
+    texture.references = 1;
+    texture.owners.clear();
+    texture.owners[getOwner(owner)] = 1;
+
+    m_mTextureCache[key] = handle;
+    return handle;
+}
+
+void CTextureManager::setSource(STexture &texture, const char *filename,
+        GLenum imageFormat, GLint internalFormat,
+        GLint level, GLint border)
+{
+    texture.source = filename;
+    texture.imageFormat = imageFormat;
+    texture.internalFormat = internalFormat;
+    texture.level = level;
+    texture.border = border;
+}
+
+unsigned int CTextureManager::getOwner(const char *owner)
+{
+    if (owner == NULL)
+        owner = "default";
+
+    std::vector<std::string>::iterator i = std::find(m_vOwner.begin(), m_vOwner.end(), owner);
+    if (i != m_vOwner.end())
+        return i - m_vOwner.begin();
+
+    m_vOwner.push_back(owner);
+    return m_vOwner.size() - 1;
+}
+
+bool CTextureManager::upload(STexture &texture, void const *pixels,
+        unsigned int width, unsigned int height,
+        GLenum imageFormat, GLint internalFormat,
+        GLint level, GLint border)
+{
+    glGenTextures(1, &texture.name);
+    glBindTexture(GL_TEXTURE_2D, texture.name);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, level, internalFormat,
+            width, height, border, imageFormat,
+            GL_UNSIGNED_BYTE, pixels);
+
+    texture.properties.width = width;
+    texture.properties.height = height;
+    charge(texture, getTextureBytes(internalFormat, width, height));
+
+    return true;
+}
+
+bool CTextureManager::loadFile(STexture &texture)
+{
+    char const *filename = texture.source.c_str();
+
+    std::string container = findContainer(filename);
+    if (!container.empty() && loadContainer(texture, container))
+        return true;
+
     FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
     FIBITMAP *dib = 0;
     BYTE *bits = 0;
 
     unsigned int width = 0, height = 0;
-    unsigned int glTextureId;
 
     fif = FreeImage_GetFileType(filename, 0);
     if (fif == FIF_UNKNOWN)
@@ -52,66 +599,297 @@ bool CTextureManager::load(const char *filename, const unsigned int textureId,
     if (!dib)
         return false;
 
+    dib = expand(dib);
+    if (!dib)
+        return false;
+
     bits = FreeImage_GetBits(dib);
     width = FreeImage_GetWidth(dib);
     height = FreeImage_GetHeight(dib);
 
     if ((bits == 0) || (width == 0) || (height == 0))
+    {
+        FreeImage_Unload(dib);
+        return false;
+    }
+
+    upload(texture, bits, width, height, GL_RGBA, texture.internalFormat,
+            texture.level, texture.border);
+
+    FreeImage_Unload(dib);
+    return true;
+}
+
+bool CTextureManager::loadContainer(STexture &texture, std::string const &file)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
         return false;
 
-    if (m_mTextureId.find(textureId) != m_mTextureId.end())
-        glDeleteTextures(1, &(m_mTextureId[textureId]));
+    bool result = false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            if (texcodec::validate(static_cast<char const *>(data), info.st_size))
+            {
+                uploadContainer(texture, static_cast<char const *>(data));
+                result = true;
+            }
+            else
+            {
+                fprintf(stderr, "[ERR] Texture Manager Error: %s is not a valid texture container.", file.c_str());
+            }
+
+            munmap(data, info.st_size);
+        }
+    }
+
+    close(fd);
+    return result;
+}
+
+void CTextureManager::uploadContainer(STexture &texture, char const *data)
+{
+    texcodec::SHeader const *header = reinterpret_cast<texcodec::SHeader const *>(data);
+    texcodec::EFormat format = texcodec::EFormat(header->format);
+
+    //! block formats the driver lacks are expanded to RGBA8 on the way in
+    bool compressed = format != texcodec::E_TF_RGBA8 && texcodec::isSupported(format);
+    std::vector<glm::uint8> pixels;
 
-    glGenTextures(1, &glTextureId);
-    m_mTextureId[textureId] = glTextureId;
-    glBindTexture(GL_TEXTURE_2D, glTextureId);
+    glGenTextures(1, &texture.name);
+    glBindTexture(GL_TEXTURE_2D, texture.name);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+            header->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->levels - 1);
 
-    glTexImage2D(GL_TEXTURE_2D, level, internalFormat,
-            width, height, border, imageFormat,
-            GL_UNSIGNED_BYTE, bits);
-    FreeImage_Unload(dib);
-    return true;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    size_t bytes = 0;
+    for (glm::uint32 i = 0; i < header->levels; i++)
+    {
+        texcodec::SLevel const &level = header->level[i];
+        glm::uint8 const *bits = reinterpret_cast<glm::uint8 const *>(data + level.offset);
+
+        if (compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, texcodec::getInternalFormat(format),
+                    level.width, level.height, 0, level.size, bits);
+            bytes += level.size;
+            continue;
+        }
+
+        if (format != texcodec::E_TF_RGBA8)
+        {
+            texcodec::decode(format, bits, level.width, level.height, pixels);
+            bits = &pixels[0];
+        }
+
+        glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.width, level.height, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, bits);
+        bytes += getTextureBytes(GL_RGBA8, level.width, level.height);
+    }
+
+    texture.properties.width = header->width;
+    texture.properties.height = header->height;
+    charge(texture, bytes);
 }
 
-bool CTextureManager::unloadTexture(const unsigned int textureId)
+void CTextureManager::charge(STexture &texture, size_t bytes)
 {
-    bool result = true;
+    m_sBudget.current += bytes;
+    m_sBudget.current -= texture.bytes;
+    m_sBudget.peak = std::max(m_sBudget.peak, m_sBudget.current);
+
+    texture.bytes = bytes;
+}
 
-    if (m_mTextureId.find(textureId) != m_mTextureId.end())
+void CTextureManager::evict(STexture &texture)
+{
+    glDeleteTextures(1, &texture.name);
+    texture.name = 0;
+    texture.evicted = true;
+    charge(texture, 0);
+
+    m_sBudget.evictions++;
+}
+
+void CTextureManager::enforceBudget()
+{
+    if (m_sBudget.budget == 0 || m_sBudget.current <= m_sBudget.budget)
+        return;
+
+    //! oldest first; anything bound this frame, still streaming in or
+    //! without a file to come back from stays resident
+    std::vector<std::pair<glm::uint32, unsigned int> > candidates;
+    for (unsigned int i = 0; i < m_sTexture.size(); i++)
     {
-        glDeleteTextures(1, &(m_mTextureId[textureId]));
-        m_mTextureId.erase(textureId);
+        STexture const &texture = m_sTexture[i];
+        if (texture.name && !texture.pending &&
+                !texture.source.empty() && texture.lastUsed != m_nFrame)
+            candidates.push_back(std::make_pair(texture.lastUsed, m_sTexture.getHandle(i)));
     }
-    else
-        result = false;
 
-    return result;
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<std::pair<glm::uint32, unsigned int> >::const_iterator i = candidates.begin();
+    for (; i != candidates.end() && m_sBudget.current > m_sBudget.budget; i++)
+        evict(*m_sTexture.get(i->second));
 }
 
-bool CTextureManager::bindTexture(const unsigned int textureId)
+void CTextureManager::destroyTexture(const unsigned int handle)
 {
-    bool result = true;
+    STexture &texture = *m_sTexture.get(handle);
 
-    if (m_mTextureId.find(textureId) != m_mTextureId.end())
-        glBindTexture(GL_TEXTURE_2D, m_mTextureId[textureId]);
-    else
-        result = false;
+    //! a pending texture still points at the shared placeholder, its
+    //! upload is dropped by update() once the handle no longer resolves
+    if (texture.name && !texture.pending)
+        glDeleteTextures(1, &texture.name);
 
-    return result;
+    m_mTextureCache.erase(texture.key);
+    charge(texture, 0);
+
+    m_sTexture.erase(handle);
 }
 
-void CTextureManager::unloadAllTextures()
+void CTextureManager::decode(SUploadJob *job)
 {
-    std::map<unsigned int, GLuint>::iterator i = m_mTextureId.begin();
+    //! runs on a worker, touches nothing but the job until it is queued
+    char const *filename = job->filename.c_str();
 
-    for (; i != m_mTextureId.end(); i++)
-        unloadTexture(i->first);
+    FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(filename, 0);
+    if (fif == FIF_UNKNOWN)
+        fif = FreeImage_GetFIFFromFilename(filename);
 
-    m_mTextureId.clear();
+    if (fif != FIF_UNKNOWN && FreeImage_FIFSupportsReading(fif))
+        job->dib = FreeImage_Load(fif, filename);
+
+    if (job->dib)
+    {
+        job->dib = expand(job->dib);
+        job->imageFormat = GL_RGBA;
+    }
+
+    if (job->dib && (!FreeImage_GetBits(job->dib) ||
+                !FreeImage_GetWidth(job->dib) || !FreeImage_GetHeight(job->dib)))
+    {
+        FreeImage_Unload(job->dib);
+        job->dib = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_sDecodeMutex);
+    m_vDecoded.push_back(job);
+}
+
+void CTextureManager::queueDecode(const unsigned int handle, STexture &texture)
+{
+    if (!m_nPlaceholder)
+    {
+        GLubyte const grey[] = { 128, 128, 128, 255 };
+
+        glGenTextures(1, &m_nPlaceholder);
+        glBindTexture(GL_TEXTURE_2D, m_nPlaceholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+        glGenBuffers(UNPACK_BUFFERS, m_vUnpackBuffer);
+    }
+
+    if (!m_psDecodePool)
+        m_psDecodePool = new CThreadPool();
+
+    texture.name = m_nPlaceholder;
+    texture.pending = true;
+
+    SUploadJob *job = new SUploadJob();
+    job->handle = handle;
+    job->filename = texture.source;
+    job->imageFormat = texture.imageFormat;
+    job->internalFormat = texture.internalFormat;
+    job->dib = 0;
+    job->name = 0;
+    job->row = 0;
+
+    m_psDecodePool->enqueue(std::bind(&CTextureManager::decode, this, job));
+}
+
+bool CTextureManager::stream(SUploadJob &job, size_t &budget)
+{
+    unsigned int width = FreeImage_GetWidth(job.dib);
+    unsigned int height = FreeImage_GetHeight(job.dib);
+    size_t pitch = FreeImage_GetPitch(job.dib);
+    BYTE const *bits = FreeImage_GetBits(job.dib);
+
+    if (!job.name)
+    {
+        glGenTextures(1, &job.name);
+        glBindTexture(GL_TEXTURE_2D, job.name);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, job.internalFormat, width, height, 0,
+                job.imageFormat, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    //! always make progress by at least one row, even past the budget
+    unsigned int rows = std::min(size_t(height - job.row), std::max(size_t(1), budget / pitch));
+    size_t size = rows * pitch;
+
+    GLuint buffer = m_vUnpackBuffer[m_nUnpackIndex];
+    m_nUnpackIndex = (m_nUnpackIndex + 1) % UNPACK_BUFFERS;
+
+    //! orphan the buffer so the copy never waits on a transfer in flight
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+    void *target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, job.name);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (target)
+    {
+        memcpy(target, bits + job.row * pitch, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.row, width, rows,
+                job.imageFormat, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.row, width, rows,
+                job.imageFormat, GL_UNSIGNED_BYTE, bits + job.row * pitch);
+    }
+
+    job.row += rows;
+    budget -= std::min(budget, size);
+
+    return job.row == height;
 }
 
+void CTextureManager::discard(SUploadJob *job)
+{
+    if (job->dib)
+        FreeImage_Unload(job->dib);
+
+    if (job->name)
+        glDeleteTextures(1, &job->name);
+
+    delete job;
+}
@@ -19,29 +19,199 @@
 #define TEXTUREMANAGER_H
 
 #include "../Commons.h"
+#include "../utils/SlotMap.h"
+#include "../utils/ThreadPool.h"
 
+//! textures are cached by canonical path plus load parameters, so two
+//! systems asking for the same image share one decode and one upload;
+//! handles are reference counted and charged to the subsystem (owner)
+//! that acquired them
 class CTextureManager
 {
 public:
+    static const unsigned int INVALID_HANDLE = 0xFFFFFFFF;
+
+    struct SImageProperties
+    {
+        unsigned int width;
+        unsigned int height;
+
+        SImageProperties() : width(0), height(0) {}
+    };
+
+    //! pixels already decoded by the caller, rows bottom up and padded to
+    //! four bytes as FreeImage hands them out
+    struct SImagePayload
+    {
+        void const *pixels;
+        unsigned int width;
+        unsigned int height;
+        GLenum format;
+    };
+
+    struct SResidency
+    {
+        unsigned int count;
+        size_t bytes;
+
+        SResidency() : count(0), bytes(0) {}
+    };
+
+    struct SBudgetStats
+    {
+        size_t budget;
+        size_t current;
+        size_t peak;
+        unsigned int evictions;
+        unsigned int reloads;
+
+        SBudgetStats() : budget(0), current(0), peak(0), evictions(0), reloads(0) {}
+    };
+
     explicit CTextureManager();
     virtual ~CTextureManager();
 
+    unsigned int acquire(const char *filename, const char *owner,
+            GLenum imageFormat = GL_RGB,
+            GLint internalFormat = GL_RGB,
+            GLint level = 0,
+            GLint border = 0);
+    unsigned int acquire(SImagePayload const &payload, const char *name,
+            const char *owner, GLint internalFormat = GL_RGB);
+    void release(const unsigned int handle, const char *owner);
+
+    //! returns at once with a placeholder bound to the handle; the image
+    //! is decoded on a worker and streamed in by update() under the per
+    //! frame upload budget, then swapped in between frames
+    unsigned int acquireAsync(const char *filename, const char *owner,
+            GLenum imageFormat = GL_RGB,
+            GLint internalFormat = GL_RGB);
+    bool isResident(const unsigned int handle) const;
+
+    void update();
+    void setUploadBudget(size_t bytes) { m_nUploadBudget = bytes; }
+
+    bool bindHandle(const unsigned int handle);
+    SImageProperties getHandleProperties(const unsigned int handle) const;
+
+    //! caller chosen ids layered over the cache, owned by "default"
     bool load(const char *filename, const unsigned int textureId,
             GLenum imageFormat = GL_RGB,
             GLint internalFormat = GL_RGB,
             GLint level = 0,
             GLint border = 0);
+    bool load(SImagePayload const &payload, const unsigned int textureId,
+            GLint internalFormat = GL_RGB);
+    bool loadAsync(const char *filename, const unsigned int textureId,
+            GLenum imageFormat = GL_RGB,
+            GLint internalFormat = GL_RGB);
 
     bool unloadTexture(const unsigned int textureId);
     bool bindTexture(const unsigned int textureId);
     void unloadAllTextures();
 
+    SImageProperties getImageProperties(const unsigned int textureId) const;
+
+    SResidency getResidency() const;
+    SResidency getResidency(const char *owner) const;
+
+    //! once resident bytes pass the budget the least recently bound
+    //! textures are evicted; the next bind shows the placeholder and
+    //! streams them back in like acquireAsync(); 0 turns the limit off
+    void setBudget(size_t bytes);
+    SBudgetStats getBudgetStats() const { return m_sBudget; }
+
 protected:
     CTextureManager(const CTextureManager& tm);
     CTextureManager& operator=(const CTextureManager& tm);
 
-    std::map<unsigned int, GLuint> m_mTextureId;
+    struct STexture
+    {
+        std::string key;
+        GLuint name;
+
+        SImageProperties properties;
+        size_t bytes;
+
+        unsigned int references;
+        std::map<unsigned int, unsigned int> owners;
+
+        //! what to load it from again after an eviction, empty for
+        //! payloads which are never evicted
+        std::string source;
+        GLenum imageFormat;
+        GLint internalFormat;
+        GLint level;
+        GLint border;
+
+        glm::uint32 lastUsed;
+        bool evicted;
+        bool pending;
+    };
+
+    //! the handle's generation tells a finished upload whether the
+    //! texture it was meant for has been released in the meantime
+    struct SUploadJob
+    {
+        unsigned int handle;
+
+        std::string filename;
+        GLenum imageFormat;
+        GLint internalFormat;
+
+        FIBITMAP *dib;
+        GLuint name;
+        unsigned int row;
+    };
+
+    unsigned int findCached(std::string const &key, const char *owner);
+    unsigned int insert(std::string const &key, const char *owner);
+    void setSource(STexture &texture, const char *filename,
+            GLenum imageFormat, GLint internalFormat,
+            GLint level, GLint border);
+    unsigned int getOwner(const char *owner);
+    bool upload(STexture &texture, void const *pixels,
+            unsigned int width, unsigned int height,
+            GLenum imageFormat, GLint internalFormat,
+            GLint level, GLint border);
+    void destroyTexture(const unsigned int handle);
+
+    bool loadFile(STexture &texture);
+    bool loadContainer(STexture &texture, std::string const &file);
+    void uploadContainer(STexture &texture, char const *data);
+
+    void charge(STexture &texture, size_t bytes);
+    void evict(STexture &texture);
+    void enforceBudget();
+
+    void queueDecode(const unsigned int handle, STexture &texture);
+    void decode(SUploadJob *job);
+    bool stream(SUploadJob &job, size_t &budget);
+    void discard(SUploadJob *job);
+
+    CSlotMap<STexture> m_sTexture;
+    std::map<std::string, unsigned int> m_mTextureCache;
+    std::vector<std::string> m_vOwner;
+
+    std::map<unsigned int, unsigned int> m_mTextureId;
+
+    CThreadPool *m_psDecodePool;
+    std::mutex m_sDecodeMutex;
+    std::vector<SUploadJob *> m_vDecoded;
+    std::vector<SUploadJob *> m_vStreaming;
+
+    enum
+    {
+        UNPACK_BUFFERS = 3
+    };
+
+    GLuint m_nPlaceholder;
+    GLuint m_vUnpackBuffer[UNPACK_BUFFERS];
+    unsigned int m_nUnpackIndex;
+    size_t m_nUploadBudget;
+
+    SBudgetStats m_sBudget;
+    glm::uint32 m_nFrame;
 };
 
 #endif /* end of include guard: TEXTUREMANAGER_H */
-
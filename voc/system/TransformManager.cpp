@@ -0,0 +1,486 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "TransformManager.h"
+
+CTransformManager::CTransformManager()
+    : m_vLevel(1, 0),
+    m_bSorted(true),
+    m_nParallelThreshold(1024),
+    m_nUpdated(0)
+{
+}
+
+CTransformManager::~CTransformManager()
+{
+}
+
+void CTransformManager::destroy()
+{
+    m_sIndex.clear();
+
+    m_vHandle.clear();
+    m_vParent.clear();
+    m_vTranslation.clear();
+    m_vRotation.clear();
+    m_vScale.clear();
+    m_vWorld.clear();
+    m_vDirty.clear();
+    m_vDepth.clear();
+    m_vFirstChild.clear();
+    m_vNextSibling.clear();
+    m_vDirtyList.clear();
+
+    m_vLevel.assign(1, 0);
+    m_bSorted = true;
+}
+
+void CTransformManager::update()
+{
+    if (!m_bSorted)
+        sort();
+
+    //! a flagged node takes its subtree along; the list grows while it is
+    //! walked, so each descendant is reached once
+    for (size_t n = 0; n < m_vDirtyList.size(); n++)
+        for (glm::uint32 c = m_vFirstChild[m_vDirtyList[n]]; c != NO_PARENT; c = m_vNextSibling[c])
+            markDirty(c);
+
+    //! the arrays are in depth order, so sorted indices come level by level
+    std::sort(m_vDirtyList.begin(), m_vDirtyList.end());
+
+    int total = m_vDirtyList.size();
+    for (int begin = 0; begin < total; )
+    {
+        glm::uint32 depth = m_vDepth[m_vDirtyList[begin]];
+        int end = std::lower_bound(m_vDirtyList.begin() + begin, m_vDirtyList.end(),
+                m_vLevel[depth + 1]) - m_vDirtyList.begin();
+        int batches = (end - begin + BATCH - 1) / BATCH;
+
+        //! a parent sits on an earlier level, so its world matrix is final
+        //! by the time its children read it
+        #pragma omp parallel for if (end - begin >= int(m_nParallelThreshold))
+        for (int b = 0; b < batches; b++)
+        {
+            glm::vec3 translation[BATCH];
+            glm::quat rotation[BATCH];
+            glm::vec3 scale[BATCH];
+            glm::mat4 parent[BATCH];
+            glm::mat4 world[BATCH];
+
+            glm::uint32 const *index = &m_vDirtyList[begin + b * BATCH];
+            unsigned int count = std::min(int(BATCH), end - begin - b * BATCH);
+            for (unsigned int n = 0; n < count; n++)
+            {
+                glm::uint32 i = index[n];
+                translation[n] = m_vTranslation[i];
+                rotation[n] = m_vRotation[i];
+                scale[n] = m_vScale[i];
+                if (m_vParent[i] != NO_PARENT)
+                    parent[n] = m_vWorld[m_vParent[i]];
+            }
+
+            mathkernels::compose(translation, rotation, scale, world, count);
+
+            //! only the first level holds roots, every deeper node has a
+            //! parent
+            if (depth > 0)
+                mathkernels::multiply(parent, world, world, count);
+
+            for (unsigned int n = 0; n < count; n++)
+                m_vWorld[index[n]] = world[n];
+        }
+
+        begin = end;
+    }
+
+    for (int n = 0; n < total; n++)
+        m_vDirty[m_vDirtyList[n]] = 0;
+    m_vDirtyList.clear();
+
+    m_nUpdated = total;
+}
+
+glm::uint32 CTransformManager::create(glm::uint32 parent)
+{
+    glm::uint32 parentIndex = NO_PARENT;
+    glm::uint32 depth = 0;
+
+    if (parent != INVALID_HANDLE)
+    {
+        parentIndex = getIndex(parent);
+        if (parentIndex == NO_PARENT)
+        {
+            fprintf(stderr, "[ERR] Transform Error: Parent does not exist.");
+            return INVALID_HANDLE;
+        }
+
+        depth = m_vDepth[parentIndex] + 1;
+    }
+
+    glm::uint32 index = m_vParent.size();
+    glm::uint32 handle = m_sIndex.insert(index);
+
+    m_vHandle.push_back(handle);
+    m_vParent.push_back(parentIndex);
+    m_vTranslation.push_back(glm::vec3(0.0));
+    m_vRotation.push_back(glm::quat());
+    m_vScale.push_back(glm::vec3(1.0));
+    m_vWorld.push_back(glm::mat4(1.0));
+    m_vDirty.push_back(1);
+    m_vDepth.push_back(depth);
+    m_vDirtyList.push_back(index);
+
+    m_vFirstChild.push_back(NO_PARENT);
+    m_vNextSibling.push_back(parentIndex == NO_PARENT ? NO_PARENT : m_vFirstChild[parentIndex]);
+    if (parentIndex != NO_PARENT)
+        m_vFirstChild[parentIndex] = index;
+
+    //! appending keeps the depth order as long as the new node is not
+    //! shallower than the deepest level, which is the common case of
+    //! building a tree top down
+    if (m_bSorted)
+    {
+        glm::uint32 levels = m_vLevel.size() - 1;
+
+        if (levels == 0 || depth == levels)
+            m_vLevel.push_back(index + 1);
+        else if (depth == levels - 1)
+            m_vLevel.back() = index + 1;
+        else
+            m_bSorted = false;
+    }
+
+    return handle;
+}
+
+void CTransformManager::remove(glm::uint32 handle)
+{
+    glm::uint32 index = getIndex(handle);
+    if (index == NO_PARENT)
+        return;
+
+    if (!m_bSorted)
+    {
+        sort();
+        index = getIndex(handle);
+    }
+
+    //! descendants all come after index, so one forward pass finds the
+    //! whole subtree; the survivors are compacted in order
+    std::vector<unsigned char> gone(m_vParent.size(), 0);
+    std::vector<glm::uint32> remap(m_vParent.size(), NO_PARENT);
+    gone[index] = 1;
+
+    glm::uint32 kept = index;
+    for (glm::uint32 i = 0; i < m_vParent.size(); i++)
+    {
+        if (i > index && m_vParent[i] != NO_PARENT && gone[m_vParent[i]])
+            gone[i] = 1;
+
+        if (gone[i])
+        {
+            m_sIndex.erase(m_vHandle[i]);
+            continue;
+        }
+
+        if (i < index)
+        {
+            remap[i] = i;
+            continue;
+        }
+
+        remap[i] = kept;
+        m_vHandle[kept] = m_vHandle[i];
+        m_vParent[kept] = (m_vParent[i] == NO_PARENT) ? NO_PARENT : remap[m_vParent[i]];
+        m_vTranslation[kept] = m_vTranslation[i];
+        m_vRotation[kept] = m_vRotation[i];
+        m_vScale[kept] = m_vScale[i];
+        m_vWorld[kept] = m_vWorld[i];
+        m_vDirty[kept] = m_vDirty[i];
+        m_vDepth[kept] = m_vDepth[i];
+
+        *m_sIndex.get(m_vHandle[kept]) = kept;
+        kept++;
+    }
+
+    m_vHandle.resize(kept);
+    m_vParent.resize(kept);
+    m_vTranslation.resize(kept);
+    m_vRotation.resize(kept);
+    m_vScale.resize(kept);
+    m_vWorld.resize(kept);
+    m_vDirty.resize(kept);
+    m_vDepth.resize(kept);
+    relink();
+
+    //! order is intact, only the level boundaries moved
+    glm::uint32 levels = kept ? m_vDepth[kept - 1] + 1 : 0;
+    m_vLevel.assign(levels + 1, 0);
+    for (glm::uint32 i = 0; i < kept; i++)
+        m_vLevel[m_vDepth[i] + 1] = i + 1;
+}
+
+bool CTransformManager::setParent(glm::uint32 handle, glm::uint32 parent)
+{
+    glm::uint32 index = getIndex(handle);
+    if (index == NO_PARENT)
+        return false;
+
+    glm::uint32 parentIndex = NO_PARENT;
+    if (parent != INVALID_HANDLE)
+    {
+        parentIndex = getIndex(parent);
+        if (parentIndex == NO_PARENT || isAncestor(index, parentIndex))
+        {
+            fprintf(stderr, "[ERR] Transform Error: Invalid parent, would form a cycle.");
+            return false;
+        }
+    }
+
+    if (m_vParent[index] == parentIndex)
+        return true;
+
+    //! out of the old parent's children, into the new one's
+    glm::uint32 old = m_vParent[index];
+    if (old != NO_PARENT)
+    {
+        glm::uint32 *link = &m_vFirstChild[old];
+        while (*link != index)
+            link = &m_vNextSibling[*link];
+        *link = m_vNextSibling[index];
+    }
+
+    m_vNextSibling[index] = (parentIndex == NO_PARENT) ? NO_PARENT : m_vFirstChild[parentIndex];
+    if (parentIndex != NO_PARENT)
+        m_vFirstChild[parentIndex] = index;
+
+    m_vParent[index] = parentIndex;
+    markDirty(index);
+    m_bSorted = false;
+    return true;
+}
+
+glm::uint32 CTransformManager::getParent(glm::uint32 handle) const
+{
+    glm::uint32 index = getIndex(handle);
+    if (index == NO_PARENT || m_vParent[index] == NO_PARENT)
+        return INVALID_HANDLE;
+
+    return m_vHandle[m_vParent[index]];
+}
+
+void CTransformManager::setTranslation(glm::uint32 handle, glm::vec3 const &translation)
+{
+    glm::uint32 index = getIndex(handle);
+    if (index == NO_PARENT)
+        return;
+
+    m_vTranslation[index] = translation;
+    markDirty(index);
+}
+
+void CTransformManager::setRotation(glm::uint32 handle, glm::quat const &rotation)
+{
+    glm::uint32 index = getIndex(handle);
+    if (index == NO_PARENT)
+        return;
+
+    m_vRotation[index] = rotation;
+    markDirty(index);
+}
+
+void CTransformManager::setScale(glm::uint32 handle, glm::vec3 const &scale)
+{
+    glm::uint32 index = getIndex(handle);
+    if (index == NO_PARENT)
+        return;
+
+    m_vScale[index] = scale;
+    markDirty(index);
+}
+
+void CTransformManager::setTransforms(glm::uint32 const *handles, glm::vec3 const *translations, glm::quat const *rotations, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::uint32 index = getIndex(handles[i]);
+        if (index == NO_PARENT)
+            continue;
+
+        m_vTranslation[index] = translations[i];
+        m_vRotation[index] = rotations[i];
+        markDirty(index);
+    }
+}
+
+glm::vec3 const &CTransformManager::getTranslation(glm::uint32 handle) const
+{
+    static glm::vec3 const origin(0.0);
+
+    glm::uint32 index = getIndex(handle);
+    return (index == NO_PARENT) ? origin : m_vTranslation[index];
+}
+
+glm::quat const &CTransformManager::getRotation(glm::uint32 handle) const
+{
+    static glm::quat const identity;
+
+    glm::uint32 index = getIndex(handle);
+    return (index == NO_PARENT) ? identity : m_vRotation[index];
+}
+
+glm::vec3 const &CTransformManager::getScale(glm::uint32 handle) const
+{
+    static glm::vec3 const unit(1.0);
+
+    glm::uint32 index = getIndex(handle);
+    return (index == NO_PARENT) ? unit : m_vScale[index];
+}
+
+glm::mat4 const &CTransformManager::getWorld(glm::uint32 handle) const
+{
+    static glm::mat4 const identity(1.0);
+
+    glm::uint32 index = getIndex(handle);
+    return (index == NO_PARENT) ? identity : m_vWorld[index];
+}
+
+glm::uint32 CTransformManager::getIndex(glm::uint32 handle) const
+{
+    glm::uint32 const *index = m_sIndex.get(handle);
+    return index ? *index : glm::uint32(NO_PARENT);
+}
+
+bool CTransformManager::isAncestor(glm::uint32 ancestor, glm::uint32 index) const
+{
+    for (; index != NO_PARENT; index = m_vParent[index])
+        if (index == ancestor)
+            return true;
+
+    return false;
+}
+
+void CTransformManager::sort()
+{
+    glm::uint32 count = m_vParent.size();
+
+    //! depths first; after a reparent the arrays are not topological, so
+    //! walk up until a node whose depth is already known
+    std::vector<glm::uint32> chain;
+    std::fill(m_vDepth.begin(), m_vDepth.end(), NO_PARENT);
+
+    glm::uint32 levels = 0;
+    for (glm::uint32 i = 0; i < count; i++)
+    {
+        glm::uint32 n = i;
+        while (n != NO_PARENT && m_vDepth[n] == NO_PARENT)
+        {
+            chain.push_back(n);
+            n = m_vParent[n];
+        }
+
+        glm::uint32 depth = (n == NO_PARENT) ? 0 : m_vDepth[n] + 1;
+        while (!chain.empty())
+        {
+            m_vDepth[chain.back()] = depth++;
+            chain.pop_back();
+        }
+
+        levels = std::max(levels, m_vDepth[i] + 1);
+    }
+
+    //! stable counting sort by depth
+    m_vLevel.assign(levels + 1, 0);
+    for (glm::uint32 i = 0; i < count; i++)
+        m_vLevel[m_vDepth[i] + 1]++;
+
+    for (glm::uint32 d = 0; d < levels; d++)
+        m_vLevel[d + 1] += m_vLevel[d];
+
+    std::vector<glm::uint32> order(count);
+    std::vector<glm::uint32> remap(count);
+    std::vector<glm::uint32> cursor(m_vLevel.begin(), m_vLevel.end() - 1);
+
+    for (glm::uint32 i = 0; i < count; i++)
+    {
+        glm::uint32 to = cursor[m_vDepth[i]]++;
+        order[to] = i;
+        remap[i] = to;
+    }
+
+    permute(m_vHandle, order);
+    permute(m_vParent, order);
+    permute(m_vTranslation, order);
+    permute(m_vRotation, order);
+    permute(m_vScale, order);
+    permute(m_vWorld, order);
+    permute(m_vDirty, order);
+    permute(m_vDepth, order);
+
+    for (glm::uint32 i = 0; i < count; i++)
+    {
+        if (m_vParent[i] != NO_PARENT)
+            m_vParent[i] = remap[m_vParent[i]];
+
+        *m_sIndex.get(m_vHandle[i]) = i;
+    }
+
+    relink();
+    m_bSorted = true;
+}
+
+void CTransformManager::markDirty(glm::uint32 index)
+{
+    if (m_vDirty[index])
+        return;
+
+    m_vDirty[index] = 1;
+    m_vDirtyList.push_back(index);
+}
+
+void CTransformManager::relink()
+{
+    glm::uint32 count = m_vParent.size();
+
+    m_vFirstChild.assign(count, NO_PARENT);
+    m_vNextSibling.resize(count);
+    m_vDirtyList.clear();
+
+    for (glm::uint32 i = count; i-- > 0; )
+    {
+        glm::uint32 p = m_vParent[i];
+        m_vNextSibling[i] = (p == NO_PARENT) ? NO_PARENT : m_vFirstChild[p];
+        if (p != NO_PARENT)
+            m_vFirstChild[p] = i;
+
+        if (m_vDirty[i])
+            m_vDirtyList.push_back(i);
+    }
+}
+
+template <typename T>
+void CTransformManager::permute(std::vector<T> &v, std::vector<glm::uint32> const &order)
+{
+    std::vector<T> sorted;
+    sorted.reserve(v.size());
+
+    for (size_t i = 0; i < order.size(); i++)
+        sorted.push_back(v[order[i]]);
+
+    v.swap(sorted);
+}
@@ -0,0 +1,126 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef TRANSFORMMANAGER_H
+#define TRANSFORMMANAGER_H
+
+#include "../Commons.h"
+#include "../utils/MathKernels.h"
+#include "../utils/SlotMap.h"
+
+//! scene transform hierarchy; nodes live in parallel arrays sorted by
+//! depth, so every parent precedes its children and the world matrices
+//! come out of one linear pass, one level at a time
+//!
+//! setters only flag the node, update() walks the flagged nodes and their
+//! subtrees and nothing else; the nodes of a level do not depend on each
+//! other, so big levels are spread across cores
+class CTransformManager
+{
+public:
+    static const glm::uint32 INVALID_HANDLE = CSlotMap<glm::uint32>::INVALID_HANDLE;
+
+    explicit CTransformManager();
+    ~CTransformManager();
+
+    void destroy();
+    void update();
+
+    glm::uint32 create(glm::uint32 parent = INVALID_HANDLE);
+    void remove(glm::uint32 handle);
+    bool contains(glm::uint32 handle) const { return m_sIndex.contains(handle); }
+
+    bool setParent(glm::uint32 handle, glm::uint32 parent);
+    glm::uint32 getParent(glm::uint32 handle) const;
+
+    void setTranslation(glm::uint32 handle, glm::vec3 const &translation);
+    void setRotation(glm::uint32 handle, glm::quat const &rotation);
+    void setScale(glm::uint32 handle, glm::vec3 const &scale);
+
+    //! translation and rotation for many nodes at once, as fed by the
+    //! physics bodies that moved; unknown handles are skipped
+    void setTransforms(glm::uint32 const *handles, glm::vec3 const *translations, glm::quat const *rotations, size_t count);
+
+    glm::vec3 const &getTranslation(glm::uint32 handle) const;
+    glm::quat const &getRotation(glm::uint32 handle) const;
+    glm::vec3 const &getScale(glm::uint32 handle) const;
+
+    //! as of the last update()
+    glm::mat4 const &getWorld(glm::uint32 handle) const;
+
+    //! levels with fewer nodes than this are updated on the calling thread
+    void setParallelThreshold(unsigned int count) { m_nParallelThreshold = count; }
+
+    unsigned int size() const { return m_vParent.size(); }
+
+    //! nodes recomputed by the last update()
+    unsigned int getUpdatedCount() const { return m_nUpdated; }
+
+private:
+    enum
+    {
+        NO_PARENT = 0xFFFFFFFF
+    };
+
+    //! nodes per batch handed to the math kernels
+    enum
+    {
+        BATCH = 64
+    };
+
+    glm::uint32 getIndex(glm::uint32 handle) const;
+    bool isAncestor(glm::uint32 ancestor, glm::uint32 index) const;
+    void markDirty(glm::uint32 index);
+
+    //! rebuilds the child links and the dirty list after nodes moved
+    void relink();
+
+    //! re-sorts the arrays by depth after parenting changes and rebuilds
+    //! the level table
+    void sort();
+
+    template <typename T>
+    void permute(std::vector<T> &v, std::vector<glm::uint32> const &order);
+
+    //! handle -> position in the arrays below
+    CSlotMap<glm::uint32> m_sIndex;
+
+    std::vector<glm::uint32> m_vHandle;
+    std::vector<glm::uint32> m_vParent;
+    std::vector<glm::vec3> m_vTranslation;
+    std::vector<glm::quat> m_vRotation;
+    std::vector<glm::vec3> m_vScale;
+    std::vector<glm::mat4> m_vWorld;
+    std::vector<unsigned char> m_vDirty;
+    std::vector<glm::uint32> m_vDepth;
+
+    //! children as singly linked lists, NO_PARENT ends them
+    std::vector<glm::uint32> m_vFirstChild;
+    std::vector<glm::uint32> m_vNextSibling;
+
+    //! the flagged nodes, so update() never visits the others
+    std::vector<glm::uint32> m_vDirtyList;
+
+    //! [m_vLevel[d], m_vLevel[d + 1]) holds the nodes at depth d
+    std::vector<glm::uint32> m_vLevel;
+
+    bool m_bSorted;
+    unsigned int m_nParallelThreshold;
+    unsigned int m_nUpdated;
+};
+
+#endif /* end of include guard: TRANSFORMMANAGER_H */
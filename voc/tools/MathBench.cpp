@@ -0,0 +1,207 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "../Commons.h"
+#include "../utils/MathKernels.h"
+
+//! checks every math kernel path the cpu supports against plain glm,
+//! value for value, and reports the throughput of each; exits non-zero
+//! on the first mismatch
+namespace
+{
+    size_t const COUNT = 4096;
+    unsigned int const PASSES = 64;
+
+    float random(float low, float high)
+    {
+        return low + (high - low) * (float(rand()) / float(RAND_MAX));
+    }
+
+    glm::vec3 randomVec3(float low, float high)
+    {
+        return glm::vec3(random(low, high), random(low, high), random(low, high));
+    }
+
+    glm::quat randomQuat()
+    {
+        glm::quat q(random(-1, 1), random(-1, 1), random(-1, 1), random(-1, 1));
+        return glm::normalize(q);
+    }
+
+    bool equal(glm::vec3 const &a, glm::vec3 const &b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    bool equal(glm::mat4 const &a, glm::mat4 const &b)
+    {
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                if (a[c][r] != b[c][r])
+                    return false;
+
+        return true;
+    }
+
+    struct SData
+    {
+        std::vector<glm::mat4> a;
+        std::vector<glm::mat4> b;
+        std::vector<glm::vec3> t;
+        std::vector<glm::quat> r;
+        std::vector<glm::vec3> s;
+        std::vector<glm::vec3> points;
+        std::vector<mathkernels::SAABB> boxes;
+        glm::vec4 planes[6];
+
+        SData()
+        {
+            glm::mat4 const projection = glm::perspective(45.0, 4.0 / 3.0, 0.1, 100.0);
+            glm::mat4 const view = glm::lookAt(glm::vec3(0, 2, 10), glm::vec3(0), glm::vec3(0, 1, 0));
+            mathkernels::extractFrustum(projection * view, planes);
+
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                t.push_back(randomVec3(-50, 50));
+                r.push_back(randomQuat());
+                s.push_back(randomVec3(-2, 2));
+
+                glm::mat4 m = glm::translate(glm::mat4(1.0), t.back()) * glm::mat4_cast(r.back());
+                a.push_back(glm::scale(m, s.back()));
+                b.push_back(glm::translate(glm::mat4(1.0), randomVec3(-5, 5)) * glm::mat4_cast(randomQuat()));
+
+                points.push_back(randomVec3(-100, 100));
+
+                mathkernels::SAABB box;
+                box.center = randomVec3(-60, 60);
+                box.extent = randomVec3(0, 4);
+                boxes.push_back(box);
+            }
+        }
+    };
+
+    //! runs kernel PASSES times and returns nanoseconds per element
+    template <typename F>
+    double time(F kernel)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (unsigned int p = 0; p < PASSES; p++)
+            kernel();
+
+        Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+        return double(elapsed) * 1.0e9 / double(SDL_GetPerformanceFrequency()) / (PASSES * COUNT);
+    }
+
+    bool check(char const *kernel, cpu::EPath path, bool passed, double ns)
+    {
+        fprintf(stdout, "[INF] %-16s %-7s %8.2f ns/elem %s\n", kernel,
+                cpu::getPathName(path), ns, passed ? "exact" : "MISMATCH");
+
+        if (!passed)
+            fprintf(stderr, "[ERR] MathBench Error: %s differs from glm on the %s path.\n",
+                    kernel, cpu::getPathName(path));
+
+        return passed;
+    }
+}
+
+int main()
+{
+    srand(1);
+    SData data;
+
+    std::vector<glm::mat4> matrices(COUNT);
+    std::vector<glm::vec3> points(COUNT);
+    std::vector<mathkernels::SAABB> boxes(COUNT);
+    std::vector<glm::uint8> visible(COUNT);
+
+    bool passed = true;
+    cpu::EPath const best = cpu::getPath();
+
+    for (int p = cpu::E_CP_SCALAR; p <= best; p++)
+    {
+        cpu::EPath path = cpu::EPath(p);
+        cpu::setPath(path);
+
+        bool exact = true;
+        double ns = time([&] { mathkernels::multiply(&data.a[0], &data.b[0], &matrices[0], COUNT); });
+        for (size_t i = 0; i < COUNT; i++)
+            exact = exact && equal(matrices[i], data.a[i] * data.b[i]);
+        passed = check("multiply", path, exact, ns) && passed;
+
+        exact = true;
+        ns = time([&] { mathkernels::multiply(data.a[0], &data.b[0], &matrices[0], COUNT); });
+        for (size_t i = 0; i < COUNT; i++)
+            exact = exact && equal(matrices[i], data.a[0] * data.b[i]);
+        passed = check("multiply-shared", path, exact, ns) && passed;
+
+        exact = true;
+        ns = time([&] { mathkernels::compose(&data.t[0], &data.r[0], &data.s[0], &matrices[0], COUNT); });
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            glm::mat4 m = glm::translate(glm::mat4(1.0), data.t[i]) * glm::mat4_cast(data.r[i]);
+            exact = exact && equal(matrices[i], glm::scale(m, data.s[i]));
+        }
+        passed = check("compose", path, exact, ns) && passed;
+
+        exact = true;
+        ns = time([&] { mathkernels::transformPoints(data.a[0], &data.points[0], &points[0], COUNT); });
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            glm::vec4 q = data.a[0] * glm::vec4(data.points[i], 1.0);
+            exact = exact && equal(points[i], glm::vec3(q.x, q.y, q.z));
+        }
+        passed = check("transformPoints", path, exact, ns) && passed;
+
+        exact = true;
+        ns = time([&] { mathkernels::transformAABBs(&data.a[0], &data.boxes[0], &boxes[0], COUNT); });
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            glm::mat4 const &m = data.a[i];
+            glm::vec3 const &e = data.boxes[i].extent;
+
+            glm::vec4 c = m * glm::vec4(data.boxes[i].center, 1.0);
+            glm::vec4 x = glm::abs(m[0]) * e.x + glm::abs(m[1]) * e.y + glm::abs(m[2]) * e.z;
+
+            exact = exact && equal(boxes[i].center, glm::vec3(c.x, c.y, c.z));
+            exact = exact && equal(boxes[i].extent, glm::vec3(x.x, x.y, x.z));
+        }
+        passed = check("transformAABBs", path, exact, ns) && passed;
+
+        exact = true;
+        ns = time([&] { mathkernels::cullAABBs(data.planes, 6, &data.boxes[0], &visible[0], COUNT); });
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            glm::vec3 const &c = data.boxes[i].center;
+            glm::vec3 const &e = data.boxes[i].extent;
+
+            glm::uint8 inside = 1;
+            for (int k = 0; k < 6; k++)
+            {
+                glm::vec3 n(data.planes[k].x, data.planes[k].y, data.planes[k].z);
+                if (glm::dot(n, c) + data.planes[k].w + glm::dot(glm::abs(n), e) < 0.0f)
+                    inside = 0;
+            }
+
+            exact = exact && visible[i] == inside;
+        }
+        passed = check("cullAABBs", path, exact, ns) && passed;
+    }
+
+    cpu::setPath(best);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,635 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "../Commons.h"
+#include "../system/PhysicsManager.h"
+
+//! headless physics suite: builds each canned scene in a manual mode
+//! CPhysicsManager, steps it and writes step time percentiles, world
+//! counters and memory as json, so runs can be diffed. also covers
+//! thread scaling on the box stacks and batched query throughput. usage:
+//! voc-physbench [--config file] [--steps N] [--threads N] [--output file]
+//! [name ...] where names pick among box_stacks, pyramids, ragdoll_piles,
+//! heightfield, cloth, ropes, scaling and queries, all of them by default;
+//! --config reads the <physics> settings being tuned from an app_config.xml.
+//! cloth and ropes run in the soft rigid world and add nodes simulated per
+//! millisecond, over as many cores as OMP_NUM_THREADS allows. scaling
+//! needs the multithreaded world (make BULLET_MT=1); without it the run
+//! writes a "scaling_error" and exits with 1 instead of timing one thread
+namespace
+{
+    unsigned int const WARMUP = 30;
+    unsigned int const THREADS[] = { 1, 2, 4, 8, 16 };
+    unsigned int const QUERIES[] = { 1000, 10000, 100000 };
+    unsigned int const OVERLAP_CAPACITY = 16;
+
+    float random(float low, float high)
+    {
+        return low + (high - low) * (float(rand()) / float(RAND_MAX));
+    }
+
+    unsigned int addGround(CPhysicsManager &physics)
+    {
+        CPhysicsManager::SBodyDesc ground;
+        ground.shape = CPhysicsManager::E_PS_PLANE;
+        ground.size = glm::vec3(0.0, 1.0, 0.0);
+        ground.mass = 0.0;
+        physics.spawn(ground);
+
+        return 1;
+    }
+
+    //! 10k boxes in stacks of ten on a square grid, close enough that the
+    //! islands touch once they start toppling
+    unsigned int boxStacks(CPhysicsManager &physics)
+    {
+        unsigned int const bodies = 10000, stack = 10;
+        unsigned int side = (unsigned int)ceil(sqrt(double(bodies / stack)));
+
+        CPhysicsManager::SBodyDesc box;
+        for (unsigned int i = 0; i < bodies; i++)
+        {
+            unsigned int s = i / stack;
+            box.position = glm::vec3(
+                    float(s % side) * 1.5f - side * 0.75f,
+                    0.5f + float(i % stack) * 1.01f,
+                    float(s / side) * 1.5f - side * 0.75f);
+            physics.spawn(box);
+        }
+
+        return addGround(physics) + bodies;
+    }
+
+    //! 25 square pyramids of 204 boxes, resting contacts in large islands
+    unsigned int pyramids(CPhysicsManager &physics)
+    {
+        int const grid = 5, base = 8;
+        unsigned int bodies = 0;
+
+        CPhysicsManager::SBodyDesc box;
+        for (int p = 0; p < grid * grid; p++)
+        {
+            glm::vec3 origin(float(p % grid - grid / 2) * (base + 4.0f), 0.0f,
+                    float(p / grid - grid / 2) * (base + 4.0f));
+
+            for (int layer = 0; layer < base; layer++)
+            {
+                int row = base - layer;
+                for (int x = 0; x < row; x++)
+                {
+                    for (int z = 0; z < row; z++)
+                    {
+                        box.position = origin + glm::vec3(
+                                (x - (row - 1) * 0.5f) * 1.01f,
+                                0.5f + layer * 1.0f,
+                                (z - (row - 1) * 0.5f) * 1.01f);
+                        physics.spawn(box);
+                        bodies++;
+                    }
+                }
+            }
+        }
+
+        return addGround(physics) + bodies;
+    }
+
+    //! 300 eleven capsule ragdolls dropped in three layers, joint heavy
+    unsigned int ragdollPiles(CPhysicsManager &physics)
+    {
+        struct SPart
+        {
+            glm::vec3 position;
+            float radius;
+            float height;
+        };
+
+        //! pelvis, spine, head, then left and right upper and lower legs
+        //! and upper and lower arms, all hanging along y
+        SPart const parts[] =
+        {
+            { glm::vec3( 0.00f, 1.00f, 0.0f), 0.15f, 0.20f },
+            { glm::vec3( 0.00f, 1.40f, 0.0f), 0.15f, 0.28f },
+            { glm::vec3( 0.00f, 1.78f, 0.0f), 0.10f, 0.05f },
+            { glm::vec3(-0.18f, 0.65f, 0.0f), 0.07f, 0.45f },
+            { glm::vec3( 0.18f, 0.65f, 0.0f), 0.07f, 0.45f },
+            { glm::vec3(-0.18f, 0.20f, 0.0f), 0.05f, 0.37f },
+            { glm::vec3( 0.18f, 0.20f, 0.0f), 0.05f, 0.37f },
+            { glm::vec3(-0.34f, 1.28f, 0.0f), 0.05f, 0.33f },
+            { glm::vec3( 0.34f, 1.28f, 0.0f), 0.05f, 0.33f },
+            { glm::vec3(-0.34f, 0.88f, 0.0f), 0.04f, 0.25f },
+            { glm::vec3( 0.34f, 0.88f, 0.0f), 0.04f, 0.25f }
+        };
+
+        struct SJoint
+        {
+            int a;
+            int b;
+            glm::vec3 pivot;
+            float swing;
+            float twist;
+        };
+
+        SJoint const joints[] =
+        {
+            { 0, 1, glm::vec3( 0.00f, 1.18f, 0.0f), 0.5f, 0.4f },
+            { 1, 2, glm::vec3( 0.00f, 1.64f, 0.0f), 0.6f, 0.8f },
+            { 0, 3, glm::vec3(-0.18f, 0.92f, 0.0f), 0.8f, 0.2f },
+            { 0, 4, glm::vec3( 0.18f, 0.92f, 0.0f), 0.8f, 0.2f },
+            { 3, 5, glm::vec3(-0.18f, 0.42f, 0.0f), 0.7f, 0.1f },
+            { 4, 6, glm::vec3( 0.18f, 0.42f, 0.0f), 0.7f, 0.1f },
+            { 1, 7, glm::vec3(-0.34f, 1.50f, 0.0f), 1.2f, 0.5f },
+            { 1, 8, glm::vec3( 0.34f, 1.50f, 0.0f), 1.2f, 0.5f },
+            { 7, 9, glm::vec3(-0.34f, 1.08f, 0.0f), 0.9f, 0.1f },
+            { 8, 10, glm::vec3( 0.34f, 1.08f, 0.0f), 0.9f, 0.1f }
+        };
+
+        size_t const partCount = sizeof(parts) / sizeof(parts[0]);
+        int const grid = 10, layers = 3;
+        unsigned int bodies = 0;
+
+        CPhysicsManager::SBodyDesc desc;
+        desc.shape = CPhysicsManager::E_PS_CAPSULE;
+        for (int r = 0; r < grid * grid * layers; r++)
+        {
+            int cell = r % (grid * grid);
+            glm::vec3 origin(float(cell % grid - grid / 2) * 1.2f + random(-0.2f, 0.2f),
+                    float(r / (grid * grid)) * 2.2f + 0.5f,
+                    float(cell / grid - grid / 2) * 1.2f + random(-0.2f, 0.2f));
+
+            glm::uint32 handles[partCount];
+            for (size_t p = 0; p < partCount; p++)
+            {
+                desc.position = origin + parts[p].position;
+                desc.size = glm::vec3(parts[p].radius, parts[p].height, 0.0f);
+                handles[p] = physics.spawn(desc);
+                bodies++;
+            }
+
+            for (size_t j = 0; j < sizeof(joints) / sizeof(joints[0]); j++)
+                physics.connect(handles[joints[j].a], handles[joints[j].b], origin + joints[j].pivot,
+                        glm::vec3(0.0f, 1.0f, 0.0f), joints[j].swing, joints[j].twist);
+        }
+
+        return addGround(physics) + bodies;
+    }
+
+    //! 50k spheres poured over 256x256 rolling terrain; the terrain is a
+    //! bvh triangle mesh, the static geometry path levels use
+    unsigned int heightfield(CPhysicsManager &physics)
+    {
+        int const size = 256;
+
+        std::vector<glm::vec3> vertices;
+        std::vector<glm::uint32> indices;
+        vertices.reserve(size * size);
+        indices.reserve((size - 1) * (size - 1) * 6);
+        for (int z = 0; z < size; z++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                float height = 2.0f * sinf(x * 0.1f) * cosf(z * 0.1f);
+                vertices.push_back(glm::vec3(x - size * 0.5f, height, z - size * 0.5f));
+            }
+        }
+
+        for (int z = 0; z + 1 < size; z++)
+        {
+            for (int x = 0; x + 1 < size; x++)
+            {
+                glm::uint32 i = z * size + x;
+                glm::uint32 quad[6] = { i, i + size, i + 1, i + 1, i + size, i + size + 1 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+
+        CPhysicsManager::SBodyDesc terrain;
+        terrain.shape = CPhysicsManager::E_PS_MESH;
+        terrain.mesh = physics.createMesh("physbench-terrain", std::move(vertices), std::move(indices));
+        physics.spawn(terrain);
+
+        unsigned int const spheres = 50000;
+        CPhysicsManager::SBodyDesc sphere;
+        sphere.shape = CPhysicsManager::E_PS_SPHERE;
+        sphere.size = glm::vec3(0.25f);
+        for (unsigned int i = 0; i < spheres; i++)
+        {
+            sphere.position = glm::vec3(float(i % 250) - 125.0f, 4.0f + random(0.0f, 2.0f),
+                    float(i / 250) - 100.0f);
+            physics.spawn(sphere);
+        }
+
+        return 1 + spheres;
+    }
+
+    //! 64 cloths of 32x32 nodes dropped over a static sphere each, apart
+    //! enough that most solve alongside each other
+    unsigned int cloth(CPhysicsManager &physics)
+    {
+        int const grid = 8;
+        unsigned int bodies = 0;
+
+        CPhysicsManager::SBodyDesc sphere;
+        sphere.shape = CPhysicsManager::E_PS_SPHERE;
+        sphere.size = glm::vec3(0.6f);
+        sphere.mass = 0.0;
+
+        CPhysicsManager::SSoftBodyDesc desc;
+        desc.shape = CPhysicsManager::E_SS_CLOTH;
+        desc.resolution[0] = 32;
+        desc.resolution[1] = 32;
+        desc.stiffness = 0.6f;
+        for (int c = 0; c < grid * grid; c++)
+        {
+            glm::vec3 origin(float(c % grid - grid / 2) * 3.0f, 0.0f, float(c / grid - grid / 2) * 3.0f);
+
+            sphere.position = origin + glm::vec3(0.0f, 1.0f, 0.0f);
+            physics.spawn(sphere);
+
+            desc.points[0] = origin + glm::vec3(-1.0f, 2.5f, -1.0f);
+            desc.points[1] = origin + glm::vec3( 1.0f, 2.5f, -1.0f);
+            desc.points[2] = origin + glm::vec3(-1.0f, 2.5f,  1.0f);
+            desc.points[3] = origin + glm::vec3( 1.0f, 2.5f,  1.0f);
+            physics.spawnSoft(desc);
+            bodies += 2;
+        }
+
+        return addGround(physics) + bodies;
+    }
+
+    //! 1024 ropes of 32 segments pinned at one end, swinging down from
+    //! level, links and nothing else to solve
+    unsigned int ropes(CPhysicsManager &physics)
+    {
+        int const grid = 32;
+
+        CPhysicsManager::SSoftBodyDesc desc;
+        desc.shape = CPhysicsManager::E_SS_ROPE;
+        desc.resolution[0] = 32;
+        desc.pinned = 1;
+        for (int r = 0; r < grid * grid; r++)
+        {
+            glm::vec3 origin(float(r % grid - grid / 2) * 4.0f, 5.0f, float(r / grid - grid / 2) * 0.5f);
+            desc.points[0] = origin;
+            desc.points[1] = origin + glm::vec3(3.0f, 0.0f, 0.0f);
+            physics.spawnSoft(desc);
+        }
+
+        return addGround(physics) + grid * grid;
+    }
+
+    struct SScene
+    {
+        char const *name;
+        unsigned int (*populate)(CPhysicsManager &physics);
+        bool soft;
+    };
+
+    SScene const SCENES[] =
+    {
+        { "box_stacks", boxStacks, false },
+        { "pyramids", pyramids, false },
+        { "ragdoll_piles", ragdollPiles, false },
+        { "heightfield", heightfield, false },
+        { "cloth", cloth, true },
+        { "ropes", ropes, true }
+    };
+
+    size_t residentKb()
+    {
+        long pages = 0, resident = 0;
+        FILE *statm = fopen("/proc/self/statm", "r");
+        if (statm)
+        {
+            if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+                resident = 0;
+            fclose(statm);
+        }
+
+        return size_t(resident) * size_t(sysconf(_SC_PAGESIZE)) / 1024;
+    }
+
+    size_t peakKb()
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return size_t(usage.ru_maxrss);
+    }
+
+    void writeDistribution(FILE *out, char const *name, std::vector<float> values, bool last = false)
+    {
+        std::sort(values.begin(), values.end());
+
+        double sum = 0.0;
+        for (size_t i = 0; i < values.size(); i++)
+            sum += values[i];
+
+        size_t n = values.size();
+        float p50 = n ? values[(n - 1) * 50 / 100] : 0.0f;
+        float p90 = n ? values[(n - 1) * 90 / 100] : 0.0f;
+        float p99 = n ? values[(n - 1) * 99 / 100] : 0.0f;
+        float max = n ? values[n - 1] : 0.0f;
+
+        fprintf(out, "\"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s",
+                name, n ? sum / n : 0.0, p50, p90, p99, max, last ? "" : ", ");
+    }
+
+    bool wanted(std::vector<std::string> const &names, char const *name)
+    {
+        return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+    }
+
+    //! steps after the warmup, stepSimulation time and counters each
+    struct SRun
+    {
+        std::vector<float> ms;
+        std::vector<float> pairs;
+        std::vector<float> manifolds;
+        std::vector<float> contacts;
+        std::vector<float> islands;
+        std::vector<float> active;
+        std::vector<float> nodes;
+
+        //! profiler sections in tree order, summed over the steps
+        std::vector<CPhysicsManager::SProfileSection> sections;
+    };
+
+    void run(CPhysicsManager &physics, unsigned int steps, SRun &result)
+    {
+        for (unsigned int s = 0; s < WARMUP; s++)
+            physics.step();
+
+        for (unsigned int s = 0; s < steps; s++)
+        {
+            physics.step();
+            physics.update();
+
+            CPhysicsManager::SStepStats const &stats = physics.getStepStats();
+            result.ms.push_back(stats.milliseconds);
+            result.pairs.push_back(float(stats.pairs));
+            result.manifolds.push_back(float(stats.manifolds));
+            result.contacts.push_back(float(stats.contacts));
+            result.islands.push_back(float(stats.islands));
+            result.active.push_back(float(stats.active));
+            result.nodes.push_back(float(stats.nodes));
+
+            //! the tree only grows, sections keep their place once seen
+            result.sections.resize(std::max(result.sections.size(), size_t(stats.sectionCount)));
+            for (unsigned int i = 0; i < stats.sectionCount; i++)
+            {
+                CPhysicsManager::SProfileSection &section = result.sections[i];
+                section.name = stats.sections[i].name;
+                section.depth = stats.sections[i].depth;
+                section.milliseconds += stats.sections[i].milliseconds;
+            }
+        }
+    }
+
+    void writeProfile(FILE *out, SRun const &result, unsigned int steps)
+    {
+        fprintf(out, "\"profile\": [");
+        for (size_t i = 0; i < result.sections.size(); i++)
+        {
+            CPhysicsManager::SProfileSection const &section = result.sections[i];
+            fprintf(out, "%s\n        { \"name\": \"%s\", \"depth\": %u, \"mean_ms\": %.4f }",
+                    i ? "," : "", section.name ? section.name : "", section.depth,
+                    steps ? section.milliseconds / steps : 0.0f);
+        }
+        fprintf(out, "%s]", result.sections.empty() ? "" : "\n      ");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int steps = 600;
+    unsigned int threads = 0;
+    char const *output = nullptr;
+    char const *configFile = nullptr;
+    std::vector<std::string> names;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--steps" && i + 1 < argc)
+            steps = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--config" && i + 1 < argc)
+            configFile = argv[++i];
+        else
+            names.push_back(arg);
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "[ERR] Physics Bench Error: Unable to write %s.\n", output);
+        return 1;
+    }
+
+    //! --threads N runs the scenes in the multithreaded world, otherwise
+    //! they run in whatever world the config asks for
+    CPhysicsManager::SConfig config;
+    if (configFile)
+        config = CPhysicsManager::loadConfig(configFile);
+    config.manual = true;
+    config.stats = true;
+    if (threads > 0)
+    {
+        config.multithreaded = true;
+        config.threads = threads;
+    }
+
+    fprintf(out, "{\n  \"steps\": %u, \"warmup\": %u, \"threads\": %u,\n", steps, WARMUP, threads);
+
+    fprintf(out, "  \"scenes\": [");
+    bool first = true;
+    for (size_t c = 0; c < sizeof(SCENES) / sizeof(SCENES[0]); c++)
+    {
+        if (!wanted(names, SCENES[c].name))
+            continue;
+
+        srand(1);
+        fprintf(stderr, "[INF] %s\n", SCENES[c].name);
+
+        size_t before = residentKb();
+
+        CPhysicsManager::SConfig sceneConfig(config);
+        sceneConfig.softBodies = sceneConfig.softBodies || SCENES[c].soft;
+
+        CPhysicsManager physics;
+        physics.init(sceneConfig);
+        unsigned int bodies = SCENES[c].populate(physics);
+
+        SRun result;
+        run(physics, steps, result);
+        size_t after = residentKb();
+
+        fprintf(out, "%s\n    { \"name\": \"%s\", \"bodies\": %u, \"threads\": %u, \"multithreaded\": %s,\n      ",
+                first ? "" : ",", SCENES[c].name, bodies, physics.getThreadCount(),
+                physics.isMultithreaded() ? "true" : "false");
+        writeDistribution(out, "step_ms", result.ms);
+        fprintf(out, "\n      ");
+        writeDistribution(out, "pairs", result.pairs);
+        writeDistribution(out, "manifolds", result.manifolds);
+        fprintf(out, "\n      ");
+        writeDistribution(out, "contacts", result.contacts);
+        writeDistribution(out, "islands", result.islands);
+        fprintf(out, "\n      ");
+        writeDistribution(out, "active", result.active);
+        if (SCENES[c].soft)
+        {
+            //! awake nodes over step time, both summed across the run
+            double nodes = 0.0, ms = 0.0;
+            for (size_t s = 0; s < result.ms.size(); s++)
+            {
+                nodes += result.nodes[s];
+                ms += result.ms[s];
+            }
+
+            fprintf(out, "\n      ");
+            writeDistribution(out, "nodes", result.nodes);
+            fprintf(out, "\"nodes_per_ms\": %.1f,", ms > 0.0 ? nodes / ms : 0.0);
+        }
+        fprintf(out, "\n      \"memory_kb\": { \"world\": %zu, \"resident\": %zu, \"peak\": %zu },\n      ",
+                after > before ? after - before : 0, after, peakKb());
+        writeProfile(out, result, steps);
+        fprintf(out, " }");
+
+        physics.destroy();
+        first = false;
+    }
+    fprintf(out, "%s],\n", first ? "" : "\n  ");
+
+    //! the box stacks once per thread count, each from the same start;
+    //! a world that fell back to one thread would only time that thread
+    //! five times over, so the section stops and the run fails instead
+    int status = 0;
+    fprintf(out, "  \"scaling\": [");
+    first = true;
+    for (size_t t = 0; t < sizeof(THREADS) / sizeof(THREADS[0]) && wanted(names, "scaling"); t++)
+    {
+        srand(1);
+        fprintf(stderr, "[INF] scaling, %u threads\n", THREADS[t]);
+
+        CPhysicsManager::SConfig scaled(config);
+        scaled.multithreaded = true;
+        scaled.threads = THREADS[t];
+
+        CPhysicsManager physics;
+        physics.init(scaled);
+        if (!physics.isMultithreaded())
+        {
+            fprintf(stderr, "[ERR] Physics Bench Error: No multithreaded world, scaling skipped.\n");
+            physics.destroy();
+            status = 1;
+            break;
+        }
+
+        unsigned int bodies = boxStacks(physics);
+
+        SRun result;
+        run(physics, steps, result);
+
+        //! the scheduler caps the request at the cores it has
+        fprintf(out, "%s\n    { \"requested\": %u, \"threads\": %u, \"bodies\": %u, ",
+                first ? "" : ",", THREADS[t], physics.getThreadCount(), bodies);
+        writeDistribution(out, "step_ms", result.ms, true);
+        fprintf(out, " }");
+
+        physics.destroy();
+        first = false;
+    }
+    fprintf(out, "%s],\n", first ? "" : "\n  ");
+    if (status)
+        fprintf(out, "  \"scaling_error\": \"single threaded world, built without BULLET_MT=1 or bullet lacks BT_THREADSAFE\",\n");
+
+    //! queries fall from above the settled stacks or cross the field
+    //! sideways, so they hit, miss and graze in proportions like gameplay's
+    fprintf(out, "  \"queries\": [");
+    first = true;
+    if (wanted(names, "queries"))
+    {
+        srand(1);
+        fprintf(stderr, "[INF] queries\n");
+
+        CPhysicsManager physics;
+        physics.init(config);
+        boxStacks(physics);
+        for (unsigned int s = 0; s < WARMUP; s++)
+            physics.step();
+
+        double frequency = double(SDL_GetPerformanceFrequency());
+        float side = float(ceil(sqrt(1000.0))) * 0.75f + 2.0f;
+        for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++)
+        {
+            unsigned int count = QUERIES[q];
+
+            std::vector<CPhysicsManager::SRay> rays(count);
+            std::vector<CPhysicsManager::SSweep> sweeps(count);
+            std::vector<CPhysicsManager::SSphere> spheres(count);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                glm::vec3 from(random(-side, side), random(0.0f, 15.0f), random(-side, side));
+                glm::vec3 to = (i & 1) ? glm::vec3(from.x, -1.0f, from.z) :
+                    glm::vec3(random(-side, side), random(0.0f, 15.0f), random(-side, side));
+
+                rays[i].from = from;
+                rays[i].to = to;
+                sweeps[i].from = from;
+                sweeps[i].to = to;
+                sweeps[i].radius = 0.25f;
+                spheres[i].center = from;
+                spheres[i].radius = 1.0f;
+            }
+
+            std::vector<CPhysicsManager::SHit> hits(count);
+            std::vector<glm::uint32> found(count * OVERLAP_CAPACITY);
+            std::vector<glm::uint32> counts(count);
+
+            char const *kinds[] = { "rays", "sweeps", "overlaps" };
+            for (int kind = 0; kind < 3; kind++)
+            {
+                Uint64 start = SDL_GetPerformanceCounter();
+                if (kind == 0)
+                    physics.raycast(&rays[0], &hits[0], count);
+                else if (kind == 1)
+                    physics.sweep(&sweeps[0], &hits[0], count);
+                else
+                    physics.overlap(&spheres[0], &found[0], &counts[0], count, OVERLAP_CAPACITY);
+                double ms = double(SDL_GetPerformanceCounter() - start) * 1000.0 / frequency;
+
+                unsigned int hit = 0;
+                for (unsigned int i = 0; i < count; i++)
+                    hit += (kind == 2) ? (counts[i] > 0) : (hits[i].body != CPhysicsManager::INVALID_BODY);
+
+                fprintf(out, "%s\n    { \"kind\": \"%s\", \"count\": %u, \"ms\": %.4f, \"per_ms\": %.1f, \"hit_rate\": %.4f }",
+                        first ? "" : ",", kinds[kind], count, ms, count / ms, double(hit) / count);
+                first = false;
+            }
+        }
+
+        physics.destroy();
+    }
+    fprintf(out, "%s]\n}\n", first ? "" : "\n  ");
+
+    if (output)
+        fclose(out);
+
+    return status;
+}
@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "../Commons.h"
+#include "../system/Renderer.h"
+#include "../system/SpriteManager.h"
+
+//! submits batches of increasing size through CSpriteManager and reports
+//! sprite throughput, run from the repository root after `make`
+int main(int argc, char *argv[])
+{
+    char const *bank = "./build/assets/textures/sprites/dream.xml";
+    if (argc > 1)
+        bank = argv[1];
+
+    CRenderer renderer;
+    renderer.init();
+
+    CTextureManager *textures = new CTextureManager();
+
+    CSpriteManager sprites;
+    sprites.init(textures);
+    unsigned int handle = sprites.addToSpriteBank(bank);
+
+    unsigned int const counts[] = { 1000, 10000, 100000 };
+    unsigned int const passes = 16;
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        Uint64 elapsed = 0;
+        unsigned int draws = 0;
+
+        for (unsigned int p = 0; p < passes; p++)
+        {
+            glFinish();
+            Uint64 start = SDL_GetPerformanceCounter();
+
+            sprites.begin();
+            for (unsigned int i = 0; i < counts[c]; i++)
+            {
+                glm::vec2 pos(float(i % 640), float((i / 640) % 480));
+                sprites.submit(handle, 0, pos,
+                        (i & 1) ? CSpriteManager::E_BM_ALPHA : CSpriteManager::E_BM_ADDITIVE);
+            }
+            sprites.end();
+
+            glFinish();
+            elapsed += SDL_GetPerformanceCounter() - start;
+            draws = sprites.getBatchStats().draws;
+        }
+
+        double ms = double(elapsed) * 1000.0 / double(SDL_GetPerformanceFrequency()) / passes;
+        fprintf(stdout, "[INF] %u sprites: %.3f ms/frame, %u draws, %.1f sprites/ms\n",
+                counts[c], ms, draws, counts[c] / ms);
+    }
+
+    sprites.destroy();
+    delete textures;
+    renderer.destroy();
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "../Commons.h"
+#include "../utils/ImageKernels.h"
+#include "../utils/TextureCodec.h"
+
+static char const *const FORMAT_NAMES[texcodec::E_TF_MAX] = {
+    "rgba8", "bc1", "bc3", "bc4", "bc5"
+};
+
+static int usage()
+{
+    fprintf(stderr, "usage: voc-texc [-f auto|rgba8|bc1|bc3|bc4|bc5] [-n] [-k] [-p] input [output]\n"
+            "  -f  container format, auto picks bc1 or bc3 from the alpha channel\n"
+            "  -n  store the base level only, no mip chain\n"
+            "  -k  build mips with a Kaiser filter instead of a 2x2 box\n"
+            "  -p  premultiply colour by alpha before encoding\n"
+            "  output defaults to input.vtc, which CTextureManager picks up in\n"
+            "  place of the source image\n");
+    return 1;
+}
+
+//! converts an image into a .vtc container holding the full mip chain,
+//! block compressed unless rgba8 is asked for
+int main(int argc, char *argv[])
+{
+    texcodec::EFormat format = texcodec::E_TF_MAX;
+    bool mipmaps = true;
+    bool kaiser = false;
+    bool premultiply = false;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-n") == 0)
+        {
+            mipmaps = false;
+        }
+        else if (strcmp(argv[arg], "-k") == 0)
+        {
+            kaiser = true;
+        }
+        else if (strcmp(argv[arg], "-p") == 0)
+        {
+            premultiply = true;
+        }
+        else if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc)
+        {
+            arg++;
+            format = texcodec::E_TF_MAX;
+            for (int i = 0; i < texcodec::E_TF_MAX; i++)
+                if (strcmp(argv[arg], FORMAT_NAMES[i]) == 0)
+                    format = texcodec::EFormat(i);
+
+            if (format == texcodec::E_TF_MAX && strcmp(argv[arg], "auto") != 0)
+                return usage();
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    if (arg >= argc)
+        return usage();
+
+    std::string input = argv[arg];
+    std::string output = arg + 1 < argc ? argv[arg + 1] : input + ".vtc";
+
+    FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(input.c_str(), 0);
+    if (fif == FIF_UNKNOWN)
+        fif = FreeImage_GetFIFFromFilename(input.c_str());
+
+    FIBITMAP *dib = 0;
+    if (fif != FIF_UNKNOWN && FreeImage_FIFSupportsReading(fif))
+        dib = FreeImage_Load(fif, input.c_str());
+
+    if (!dib)
+    {
+        fprintf(stderr, "[ERR] Texture Compiler Error: Unable to load %s.\n", input.c_str());
+        return 1;
+    }
+
+    FIBITMAP *converted = FreeImage_ConvertTo32Bits(dib);
+    FreeImage_Unload(dib);
+
+    if (!converted)
+    {
+        fprintf(stderr, "[ERR] Texture Compiler Error: Unable to convert %s.\n", input.c_str());
+        return 1;
+    }
+
+    unsigned int width = FreeImage_GetWidth(converted);
+    unsigned int height = FreeImage_GetHeight(converted);
+
+    //! FreeImage rows stay bottom up, which is the order glTexImage2D
+    //! expects; only the channel order needs fixing
+    std::vector<glm::uint8> image(size_t(width) * height * 4);
+    for (unsigned int y = 0; y < height; y++)
+        memcpy(&image[size_t(y) * width * 4], FreeImage_GetScanLine(converted, y), size_t(width) * 4);
+
+    FreeImage_Unload(converted);
+
+    if (FI_RGBA_RED != 0)
+        kernels::swizzleRB(&image[0], width, height, size_t(width) * 4);
+
+    bool opaque = true;
+    for (size_t i = 3; i < image.size() && opaque; i += 4)
+        opaque = image[i] == 255;
+
+    if (premultiply && !opaque)
+        kernels::premultiply(&image[0], width, height, size_t(width) * 4);
+
+    if (format == texcodec::E_TF_MAX)
+        format = opaque ? texcodec::E_TF_BC1 : texcodec::E_TF_BC3;
+
+    texcodec::SHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "VTC1", 4);
+    header.version = 1;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.levels = 1;
+
+    if (mipmaps)
+        while (header.levels < texcodec::MAX_LEVELS &&
+                ((width >> header.levels) > 0 || (height >> header.levels) > 0))
+            header.levels++;
+
+    std::vector<glm::uint8> data;
+    std::vector<glm::uint8> encoded;
+    std::vector<glm::uint8> smaller;
+
+    size_t offset = sizeof(header);
+    for (glm::uint32 i = 0; i < header.levels; i++)
+    {
+        unsigned int w = std::max(width >> i, 1u);
+        unsigned int h = std::max(height >> i, 1u);
+
+        if (i > 0)
+        {
+            unsigned int pw = std::max(width >> (i - 1), 1u);
+            unsigned int ph = std::max(height >> (i - 1), 1u);
+
+            if (kaiser)
+                kernels::downsampleKaiser(&image[0], pw, ph, size_t(pw) * 4, smaller);
+            else
+                kernels::downsampleBox(&image[0], pw, ph, size_t(pw) * 4, smaller);
+            image.swap(smaller);
+        }
+
+        texcodec::encode(format, &image[0], w, h, encoded);
+
+        offset = (offset + 15) & ~size_t(15);
+        header.level[i].offset = offset;
+        header.level[i].size = encoded.size();
+        header.level[i].width = w;
+        header.level[i].height = h;
+
+        data.resize(offset - sizeof(header));
+        data.insert(data.end(), encoded.begin(), encoded.end());
+        offset += encoded.size();
+    }
+
+    FILE *out = fopen(output.c_str(), "wb");
+    if (!out)
+    {
+        fprintf(stderr, "[ERR] Texture Compiler Error: Unable to write %s.\n", output.c_str());
+        return 1;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+        (data.empty() || fwrite(&data[0], data.size(), 1, out) == 1);
+    fclose(out);
+
+    if (!written)
+    {
+        fprintf(stderr, "[ERR] Texture Compiler Error: Unable to write %s.\n", output.c_str());
+        remove(output.c_str());
+        return 1;
+    }
+
+    fprintf(stdout, "[INF] %s: %ux%u %s, %u levels, %zu bytes (%zu uncompressed)\n",
+            output.c_str(), width, height, FORMAT_NAMES[format], header.levels,
+            sizeof(header) + data.size(), size_t(width) * height * 4);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "CpuFeatures.h"
+
+namespace
+{
+    cpu::EPath detectPath()
+    {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return cpu::E_CP_AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return cpu::E_CP_AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return cpu::E_CP_SSE2;
+#endif
+        return cpu::E_CP_SCALAR;
+    }
+
+    //! E_CP_MAX until someone narrows it; a constant, so it is set before
+    //! any other static initialiser could ask
+    cpu::EPath g_eForced = cpu::E_CP_MAX;
+}
+
+cpu::EPath cpu::getSupported()
+{
+    static EPath const supported = detectPath();
+    return supported;
+}
+
+cpu::EPath cpu::getPath()
+{
+    return std::min(g_eForced, getSupported());
+}
+
+char const *cpu::getPathName(EPath path)
+{
+    char const *names[E_CP_MAX] = { "scalar", "sse2", "avx2", "avx512" };
+    return (path < E_CP_MAX) ? names[path] : "unknown";
+}
+
+void cpu::setPath(EPath path)
+{
+    g_eForced = path;
+}
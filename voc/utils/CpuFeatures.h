@@ -0,0 +1,47 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef _CPUFEATURES_H_
+#define _CPUFEATURES_H_
+
+#include "../Commons.h"
+
+//! the instruction set the hand vectorised kernels run on; the cpu is
+//! probed once and every kernel module reads the same choice
+namespace cpu
+{
+    enum EPath
+    {
+        E_CP_SCALAR = 0,
+        E_CP_SSE2,
+        E_CP_AVX2,
+        E_CP_AVX512,
+        E_CP_MAX
+    };
+
+    //! the widest path this cpu runs
+    EPath getSupported();
+
+    EPath getPath();
+    char const *getPathName(EPath path);
+
+    //! forces a narrower path, mostly for comparing them; a path the cpu
+    //! lacks falls back to the best one it has
+    void setPath(EPath path);
+}
+
+#endif /* end of include guard: _CPUFEATURES_H_ */
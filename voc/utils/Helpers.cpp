@@ -38,6 +38,65 @@ namespace helpers
         return result;
     }
 
+    glm::uint32 decodeUTF8(char const *&p)
+    {
+        //! decodes one codepoint and advances p past it, malformed
+        //! sequences yield U+FFFD and consume a single byte
+        unsigned char const *s = reinterpret_cast<unsigned char const *>(p);
+        glm::uint32 const replacement = 0xFFFD;
+
+        if (s[0] < 0x80)
+        {
+            p += 1;
+            return s[0];
+        }
+
+        int length = 0;
+        glm::uint32 codepoint = 0;
+        glm::uint32 minimum = 0;
+        if ((s[0] & 0xE0) == 0xC0)
+        {
+            length = 2;
+            codepoint = s[0] & 0x1F;
+            minimum = 0x80;
+        }
+        else if ((s[0] & 0xF0) == 0xE0)
+        {
+            length = 3;
+            codepoint = s[0] & 0x0F;
+            minimum = 0x800;
+        }
+        else if ((s[0] & 0xF8) == 0xF0)
+        {
+            length = 4;
+            codepoint = s[0] & 0x07;
+            minimum = 0x10000;
+        }
+        else
+        {
+            p += 1;
+            return replacement;
+        }
+
+        for (int i = 1; i < length; i++)
+        {
+            if ((s[i] & 0xC0) != 0x80)
+            {
+                p += 1;
+                return replacement;
+            }
+
+            codepoint = (codepoint << 6) | (s[i] & 0x3F);
+        }
+
+        p += length;
+        if (codepoint < minimum || codepoint > 0x10FFFF ||
+                (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+            return replacement;
+
+        return codepoint;
+    }
+
     GLuint createShader(GLenum type, std::string const &source)
     {
         GLuint name = 0;
@@ -72,6 +72,7 @@ namespace helpers
             enum type
             {
                 POSITION = 0,
+                NORMAL = 1,
                 COLOR = 3,
                 TEXCOORD = 4,
                 DRAW_ID = 5
@@ -134,6 +135,7 @@ namespace helpers
     };
 
     std::string loadFile(std::string const &file);
+    glm::uint32 decodeUTF8(char const *&p);
     GLuint createShader(GLenum type, std::string const &source);
     bool checkShader(GLuint shader, std::string const &file);
     bool checkProgram(GLuint program);
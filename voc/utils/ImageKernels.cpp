@@ -0,0 +1,479 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "ImageKernels.h"
+
+namespace
+{
+    typedef void (*RowKernel)(glm::uint8 *row, unsigned int width);
+    typedef void (*ExpandKernel)(glm::uint8 const *row, unsigned int width, glm::uint8 *out, bool swizzle);
+
+    //! below this many rows the thread fan-out costs more than it saves
+    const unsigned int PARALLEL_ROWS = 64;
+
+    //! exact round(c * a / 255) without a division, shared by every path
+    inline glm::uint8 multiply(unsigned int c, unsigned int a)
+    {
+        unsigned int t = c * a + 128;
+        return glm::uint8((t + (t >> 8)) >> 8);
+    }
+
+    void swizzleScalar(glm::uint8 *row, unsigned int width)
+    {
+        for (unsigned int x = 0; x < width; x++)
+            std::swap(row[x * 4], row[x * 4 + 2]);
+    }
+
+    void premultiplyScalar(glm::uint8 *row, unsigned int width)
+    {
+        for (unsigned int x = 0; x < width; x++)
+        {
+            glm::uint8 *p = row + x * 4;
+            p[0] = multiply(p[0], p[3]);
+            p[1] = multiply(p[1], p[3]);
+            p[2] = multiply(p[2], p[3]);
+        }
+    }
+
+    void expandScalar(glm::uint8 const *row, unsigned int width, glm::uint8 *out, bool swizzle)
+    {
+        int const r = swizzle ? 2 : 0;
+        int const b = swizzle ? 0 : 2;
+
+        for (unsigned int x = 0; x < width; x++)
+        {
+            out[x * 4] = row[x * 3 + r];
+            out[x * 4 + 1] = row[x * 3 + 1];
+            out[x * 4 + 2] = row[x * 3 + b];
+            out[x * 4 + 3] = 255;
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    void swizzleSSE2(glm::uint8 *row, unsigned int width)
+    {
+        __m128i const ga = _mm_set1_epi32(0xFF00FF00);
+        __m128i const low = _mm_set1_epi32(0x000000FF);
+
+        unsigned int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i *p = reinterpret_cast<__m128i *>(row + x * 4);
+            __m128i v = _mm_loadu_si128(p);
+
+            __m128i r = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+            _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(v, ga), _mm_or_si128(r, b)));
+        }
+
+        swizzleScalar(row + x * 4, width - x);
+    }
+
+    void premultiplySSE2(glm::uint8 *row, unsigned int width)
+    {
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const rgb = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        __m128i const alpha = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+        __m128i const bias = _mm_set1_epi16(128);
+
+        unsigned int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i *p = reinterpret_cast<__m128i *>(row + x * 4);
+            __m128i v = _mm_loadu_si128(p);
+
+            __m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+            for (int h = 0; h < 2; h++)
+            {
+                //! broadcast each texel's alpha, alpha itself is scaled by 255
+                __m128i a = _mm_shufflelo_epi16(halves[h], _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm_or_si128(_mm_and_si128(a, rgb), alpha);
+
+                __m128i t = _mm_add_epi16(_mm_mullo_epi16(halves[h], a), bias);
+                halves[h] = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+            }
+
+            _mm_storeu_si128(p, _mm_packus_epi16(halves[0], halves[1]));
+        }
+
+        premultiplyScalar(row + x * 4, width - x);
+    }
+
+    __attribute__((target("avx2")))
+    void swizzleAVX2(glm::uint8 *row, unsigned int width)
+    {
+        __m256i const ga = _mm256_set1_epi32(0xFF00FF00);
+        __m256i const low = _mm256_set1_epi32(0x000000FF);
+
+        unsigned int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i *p = reinterpret_cast<__m256i *>(row + x * 4);
+            __m256i v = _mm256_loadu_si256(p);
+
+            __m256i r = _mm256_slli_epi32(_mm256_and_si256(v, low), 16);
+            __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 16), low);
+            _mm256_storeu_si256(p, _mm256_or_si256(_mm256_and_si256(v, ga), _mm256_or_si256(r, b)));
+        }
+
+        swizzleSSE2(row + x * 4, width - x);
+    }
+
+    __attribute__((target("avx2")))
+    void premultiplyAVX2(glm::uint8 *row, unsigned int width)
+    {
+        __m256i const zero = _mm256_setzero_si256();
+        __m256i const rgb = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1,
+                0, -1, -1, -1, 0, -1, -1, -1);
+        __m256i const alpha = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0,
+                255, 0, 0, 0, 255, 0, 0, 0);
+        __m256i const bias = _mm256_set1_epi16(128);
+
+        unsigned int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i *p = reinterpret_cast<__m256i *>(row + x * 4);
+            __m256i v = _mm256_loadu_si256(p);
+
+            //! unpack and pack both stay inside 128 bit lanes, so texels
+            //! come back out in the order they went in
+            __m256i halves[2] = { _mm256_unpacklo_epi8(v, zero), _mm256_unpackhi_epi8(v, zero) };
+            for (int h = 0; h < 2; h++)
+            {
+                __m256i a = _mm256_shufflelo_epi16(halves[h], _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm256_or_si256(_mm256_and_si256(a, rgb), alpha);
+
+                __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(halves[h], a), bias);
+                halves[h] = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+            }
+
+            _mm256_storeu_si256(p, _mm256_packus_epi16(halves[0], halves[1]));
+        }
+
+        premultiplySSE2(row + x * 4, width - x);
+    }
+
+    //! SSE2 has no byte shuffle, so only this path has a vector expand;
+    //! each lane turns four texels into four, the upper one loading from
+    //! the fifth texel on
+    __attribute__((target("avx2")))
+    void expandAVX2(glm::uint8 const *row, unsigned int width, glm::uint8 *out, bool swizzle)
+    {
+        __m256i const order = swizzle ?
+            _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                    2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+            _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                    0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        __m256i const alpha = _mm256_set1_epi32(0xFF000000);
+
+        //! a lane loads 16 bytes for the 12 it uses, the last load must
+        //! still end inside the row
+        unsigned int x = 0;
+        for (; size_t(x) * 3 + 28 <= size_t(width) * 3; x += 8)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<__m128i const *>(row + x * 3));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<__m128i const *>(row + x * 3 + 12));
+            __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+            v = _mm256_or_si256(_mm256_shuffle_epi8(v, order), alpha);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x * 4), v);
+        }
+
+        expandScalar(row + x * 3, width - x, out + x * 4, swizzle);
+    }
+#endif
+
+    RowKernel selectSwizzle()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu::getPath() >= cpu::E_CP_AVX2)
+            return swizzleAVX2;
+        if (cpu::getPath() >= cpu::E_CP_SSE2)
+            return swizzleSSE2;
+#endif
+        return swizzleScalar;
+    }
+
+    RowKernel selectPremultiply()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu::getPath() >= cpu::E_CP_AVX2)
+            return premultiplyAVX2;
+        if (cpu::getPath() >= cpu::E_CP_SSE2)
+            return premultiplySSE2;
+#endif
+        return premultiplyScalar;
+    }
+
+    void forEachRow(RowKernel kernel, glm::uint8 *pixels,
+            unsigned int width, unsigned int height, size_t pitch)
+    {
+        #pragma omp parallel for if (height >= PARALLEL_ROWS)
+        for (int y = 0; y < int(height); y++)
+            kernel(pixels + y * pitch, width);
+    }
+
+    //! 8 bit in, 8 bit out; a 256 entry table beats any gather or
+    //! polynomial at this precision, so sRGB has no vector path
+    struct STransfer
+    {
+        glm::uint8 toLinear[256];
+        glm::uint8 toSrgb[256];
+
+        STransfer()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+
+                float linear = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+                float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+
+                toLinear[i] = glm::uint8(linear * 255.0f + 0.5f);
+                toSrgb[i] = glm::uint8(srgb * 255.0f + 0.5f);
+            }
+        }
+    };
+
+    STransfer const g_sTransfer;
+
+    void transfer(glm::uint8 const *table, glm::uint8 *pixels,
+            unsigned int width, unsigned int height, size_t pitch)
+    {
+        #pragma omp parallel for if (height >= PARALLEL_ROWS)
+        for (int y = 0; y < int(height); y++)
+        {
+            glm::uint8 *row = pixels + y * pitch;
+            for (unsigned int x = 0; x < width; x++)
+            {
+                row[x * 4] = table[row[x * 4]];
+                row[x * 4 + 1] = table[row[x * 4 + 1]];
+                row[x * 4 + 2] = table[row[x * 4 + 2]];
+            }
+        }
+    }
+
+    void boxScalar(glm::uint8 const *r0, glm::uint8 const *r1, unsigned int width,
+            unsigned int first, unsigned int last, glm::uint8 *out)
+    {
+        for (unsigned int x = first; x < last; x++)
+        {
+            unsigned int x0 = std::min(x * 2, width - 1) * 4;
+            unsigned int x1 = std::min(x * 2 + 1, width - 1) * 4;
+
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = glm::uint8((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2);
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    //! two output texels per step from a 4x2 source footprint; the AVX2
+    //! path shares this one since the lane crossing costs what it gains
+    unsigned int boxSSE2(glm::uint8 const *r0, glm::uint8 const *r1, unsigned int width,
+            unsigned int count, glm::uint8 *out)
+    {
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const bias = _mm_set1_epi16(2);
+
+        unsigned int x = 0;
+        for (; x + 2 <= count && x * 2 + 4 <= width; x += 2)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(r0 + x * 8));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(r1 + x * 8));
+
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+            __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), bias), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * 4), _mm_packus_epi16(sum, zero));
+        }
+
+        return x;
+    }
+#endif
+
+    float besselI0(float x)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 16; k++)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    //! six taps of a Kaiser windowed sinc centred between the two source
+    //! texels each output texel covers
+    struct SKaiser
+    {
+        float weights[6];
+
+        SKaiser()
+        {
+            float const beta = 4.0f;
+            float const radius = 3.0f;
+            float total = 0.0f;
+
+            for (int i = 0; i < 6; i++)
+            {
+                float d = i - 2.5f;
+                float x = d * 0.5f;
+                float sinc = fabsf(x) < 1e-6f ? 1.0f : sinf(float(M_PI) * x) / (float(M_PI) * x);
+                float r = d / radius;
+
+                weights[i] = sinc * besselI0(beta * sqrtf(std::max(0.0f, 1.0f - r * r))) / besselI0(beta);
+                total += weights[i];
+            }
+
+            for (int i = 0; i < 6; i++)
+                weights[i] /= total;
+        }
+    };
+
+    SKaiser const g_sKaiser;
+}
+
+void kernels::swizzleRB(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch)
+{
+    forEachRow(selectSwizzle(), pixels, width, height, pitch);
+}
+
+void kernels::premultiply(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch)
+{
+    forEachRow(selectPremultiply(), pixels, width, height, pitch);
+}
+
+void kernels::srgbToLinear(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch)
+{
+    transfer(g_sTransfer.toLinear, pixels, width, height, pitch);
+}
+
+void kernels::linearToSrgb(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch)
+{
+    transfer(g_sTransfer.toSrgb, pixels, width, height, pitch);
+}
+
+void kernels::expandRGB(glm::uint8 const *pixels, unsigned int width, unsigned int height, size_t pitch,
+        glm::uint8 *out, size_t outPitch, bool swizzle)
+{
+    ExpandKernel kernel = expandScalar;
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::getPath() >= cpu::E_CP_AVX2)
+        kernel = expandAVX2;
+#endif
+
+    #pragma omp parallel for if (height >= PARALLEL_ROWS)
+    for (int y = 0; y < int(height); y++)
+        kernel(pixels + y * pitch, width, out + y * outPitch, swizzle);
+}
+
+void kernels::flipRows(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch)
+{
+    size_t bytes = size_t(width) * 4;
+
+    //! swap_ranges over bytes is vectorised by the compiler already
+    #pragma omp parallel for if (height >= PARALLEL_ROWS)
+    for (int y = 0; y < int(height / 2); y++)
+    {
+        glm::uint8 *top = pixels + y * pitch;
+        glm::uint8 *bottom = pixels + (height - 1 - y) * pitch;
+        std::swap_ranges(top, top + bytes, bottom);
+    }
+}
+
+void kernels::downsampleBox(glm::uint8 const *pixels, unsigned int width, unsigned int height,
+        size_t pitch, std::vector<glm::uint8> &out)
+{
+    unsigned int w = std::max(width / 2, 1u);
+    unsigned int h = std::max(height / 2, 1u);
+    out.resize(size_t(w) * h * 4);
+
+    glm::uint8 *target = &out[0];
+
+    //! odd edges fold the last texel in twice
+    #pragma omp parallel for if (h >= PARALLEL_ROWS)
+    for (int y = 0; y < int(h); y++)
+    {
+        glm::uint8 const *r0 = pixels + std::min(unsigned(y) * 2, height - 1) * pitch;
+        glm::uint8 const *r1 = pixels + std::min(unsigned(y) * 2 + 1, height - 1) * pitch;
+        glm::uint8 *row = target + size_t(y) * w * 4;
+
+        unsigned int x = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu::getPath() != cpu::E_CP_SCALAR)
+            x = boxSSE2(r0, r1, width, w, row);
+#endif
+        boxScalar(r0, r1, width, x, w, row);
+    }
+}
+
+void kernels::downsampleKaiser(glm::uint8 const *pixels, unsigned int width, unsigned int height,
+        size_t pitch, std::vector<glm::uint8> &out)
+{
+    unsigned int w = std::max(width / 2, 1u);
+    unsigned int h = std::max(height / 2, 1u);
+    out.resize(size_t(w) * h * 4);
+
+    //! separable: a horizontal pass into floats, then a vertical pass
+    std::vector<float> temporary(size_t(w) * height * 4);
+    float const *weights = g_sKaiser.weights;
+
+    #pragma omp parallel for if (height >= PARALLEL_ROWS)
+    for (int y = 0; y < int(height); y++)
+    {
+        glm::uint8 const *row = pixels + y * pitch;
+        float *target = &temporary[size_t(y) * w * 4];
+
+        for (unsigned int x = 0; x < w; x++)
+        {
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int t = 0; t < 6; t++)
+            {
+                int sx = std::min(std::max(int(x) * 2 - 2 + t, 0), int(width) - 1);
+                for (int c = 0; c < 4; c++)
+                    sum[c] += weights[t] * row[sx * 4 + c];
+            }
+
+            memcpy(target + x * 4, sum, sizeof(sum));
+        }
+    }
+
+    #pragma omp parallel for if (h >= PARALLEL_ROWS)
+    for (int y = 0; y < int(h); y++)
+    {
+        glm::uint8 *target = &out[size_t(y) * w * 4];
+
+        for (unsigned int x = 0; x < w * 4; x++)
+        {
+            float sum = 0.0f;
+            for (int t = 0; t < 6; t++)
+            {
+                int sy = std::min(std::max(y * 2 - 2 + t, 0), int(height) - 1);
+                sum += weights[t] * temporary[size_t(sy) * w * 4 + x];
+            }
+
+            target[x] = glm::uint8(std::min(std::max(sum + 0.5f, 0.0f), 255.0f));
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef _IMAGEKERNELS_H_
+#define _IMAGEKERNELS_H_
+
+#include "../Commons.h"
+#include "CpuFeatures.h"
+
+//! per row image kernels for texture ingest, working in place on RGBA8
+//! (or BGRA8) rows of any pitch; rows are spread across threads, avx-512
+//! runs the avx2 bodies
+namespace kernels
+{
+    void swizzleRB(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch);
+    void premultiply(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch);
+    void srgbToLinear(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch);
+    void linearToSrgb(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch);
+    void flipRows(glm::uint8 *pixels, unsigned int width, unsigned int height, size_t pitch);
+
+    //! three byte texels out to four with opaque alpha, swapping R and B
+    //! on the way when asked; out takes width * 4 bytes per row
+    void expandRGB(glm::uint8 const *pixels, unsigned int width, unsigned int height, size_t pitch,
+            glm::uint8 *out, size_t outPitch, bool swizzle);
+
+    //! halve each side (never below one texel); out is tightly packed
+    void downsampleBox(glm::uint8 const *pixels, unsigned int width, unsigned int height,
+            size_t pitch, std::vector<glm::uint8> &out);
+    void downsampleKaiser(glm::uint8 const *pixels, unsigned int width, unsigned int height,
+            size_t pitch, std::vector<glm::uint8> &out);
+}
+
+#endif /* end of include guard: _IMAGEKERNELS_H_ */
@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "LinearArena.h"
+
+CLinearArena::CLinearArena(size_t capacity)
+    : m_nUsed(0),
+    m_nPeak(0),
+    m_nAllocations(0)
+{
+    addBlock(capacity);
+}
+
+CLinearArena::~CLinearArena()
+{
+    std::vector<SBlock>::iterator i = m_vBlock.begin();
+    for (; i != m_vBlock.end(); i++)
+        delete [] i->data;
+}
+
+void *CLinearArena::allocate(size_t bytes, size_t alignment)
+{
+    SBlock *block = &m_vBlock.back();
+
+    size_t offset = (reinterpret_cast<size_t>(block->data) + block->used + alignment - 1) & ~(alignment - 1);
+    offset -= reinterpret_cast<size_t>(block->data);
+
+    if (offset + bytes > block->size)
+    {
+        //! grow geometrically so a large load settles after a few blocks
+        addBlock(std::max(block->size * 2, bytes + alignment));
+        block = &m_vBlock.back();
+
+        offset = (reinterpret_cast<size_t>(block->data) + alignment - 1) & ~(alignment - 1);
+        offset -= reinterpret_cast<size_t>(block->data);
+    }
+
+    m_nUsed += offset + bytes - block->used;
+    m_nPeak = std::max(m_nPeak, m_nUsed);
+    block->used = offset + bytes;
+
+    return block->data + offset;
+}
+
+bool CLinearArena::contains(void const *p) const
+{
+    char const *c = static_cast<char const *>(p);
+
+    std::vector<SBlock>::const_iterator i = m_vBlock.begin();
+    for (; i != m_vBlock.end(); i++)
+        if (c >= i->data && c < i->data + i->size)
+            return true;
+
+    return false;
+}
+
+void CLinearArena::reset()
+{
+    if (m_vBlock.size() > 1)
+    {
+        size_t size = 0;
+
+        std::vector<SBlock>::iterator i = m_vBlock.begin();
+        for (; i != m_vBlock.end(); i++)
+        {
+            size += i->size;
+            delete [] i->data;
+        }
+
+        m_vBlock.clear();
+        addBlock(size);
+    }
+
+    m_vBlock.back().used = 0;
+    m_nUsed = 0;
+}
+
+void CLinearArena::addBlock(size_t size)
+{
+    SBlock block;
+    block.data = new char[size];
+    block.size = size;
+    block.used = 0;
+
+    m_vBlock.push_back(block);
+    m_nAllocations++;
+}
@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef LINEARARENA_H
+#define LINEARARENA_H
+
+#include "../Commons.h"
+
+//! bump allocator for scratch data that dies together, e.g. everything a
+//! single load stages on the CPU; reset() hands it all back at once and,
+//! if the last round needed more than one block, folds them into a single
+//! block big enough that the next round allocates nothing
+class CLinearArena
+{
+public:
+    explicit CLinearArena(size_t capacity = 1 << 20);
+    ~CLinearArena();
+
+    void *allocate(size_t bytes, size_t alignment = 16);
+
+    template <typename T>
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    bool contains(void const *p) const;
+    void reset();
+
+    size_t getUsed() const { return m_nUsed; }
+    size_t getPeak() const { return m_nPeak; }
+
+    //! heap allocations made since construction
+    unsigned int getAllocationCount() const { return m_nAllocations; }
+
+private:
+    CLinearArena(const CLinearArena &la);
+    CLinearArena& operator=(const CLinearArena &la);
+
+    struct SBlock
+    {
+        char *data;
+        size_t size;
+        size_t used;
+    };
+
+    void addBlock(size_t size);
+
+    std::vector<SBlock> m_vBlock;
+
+    size_t m_nUsed;
+    size_t m_nPeak;
+    unsigned int m_nAllocations;
+};
+
+#endif /* end of include guard: LINEARARENA_H */
@@ -0,0 +1,477 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "MathKernels.h"
+
+namespace
+{
+    //! the sums below are spelled in glm's association order, mat4 * mat4
+    //! left to right and mat4 * vec4 pairwise, which is what keeps every
+    //! path exact against it
+
+    void multiplyScalar(glm::mat4 const *a, size_t strideA, glm::mat4 const *b,
+            glm::mat4 *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            out[i] = a[i * strideA] * b[i];
+    }
+
+    void composeScalar(glm::vec3 const *t, glm::quat const *r, glm::vec3 const *s,
+            glm::mat4 *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::mat4 m = glm::mat4_cast(r[i]);
+            m[0] = m[0] * s[i].x;
+            m[1] = m[1] * s[i].y;
+            m[2] = m[2] * s[i].z;
+            m[3] = glm::vec4(t[i], 1.0f);
+            out[i] = m;
+        }
+    }
+
+    void transformPointsScalar(glm::mat4 const &m, glm::vec3 const *in, glm::vec3 *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::vec4 p = m * glm::vec4(in[i], 1.0f);
+            out[i] = glm::vec3(p.x, p.y, p.z);
+        }
+    }
+
+    void transformAABBsScalar(glm::mat4 const *m, mathkernels::SAABB const *in,
+            mathkernels::SAABB *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::mat4 const &t = m[i];
+            glm::vec3 const e = in[i].extent;
+
+            glm::vec4 c = t * glm::vec4(in[i].center, 1.0f);
+            out[i].center = glm::vec3(c.x, c.y, c.z);
+
+            for (int k = 0; k < 3; k++)
+                out[i].extent[k] = std::fabs(t[0][k]) * e.x + std::fabs(t[1][k]) * e.y + std::fabs(t[2][k]) * e.z;
+        }
+    }
+
+    void cullScalar(glm::vec4 const *planes, unsigned int planeCount,
+            mathkernels::SAABB const *boxes, glm::uint8 *visible, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::vec3 const &c = boxes[i].center;
+            glm::vec3 const &e = boxes[i].extent;
+
+            glm::uint8 inside = 1;
+            for (unsigned int p = 0; p < planeCount && inside; p++)
+            {
+                glm::vec4 const &n = planes[p];
+                float dist = n.x * c.x + n.y * c.y + n.z * c.z + n.w;
+                float radius = std::fabs(n.x) * e.x + std::fabs(n.y) * e.y + std::fabs(n.z) * e.z;
+
+                if (dist + radius < 0.0f)
+                    inside = 0;
+            }
+
+            visible[i] = inside;
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    inline __m128 abs(__m128 v)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+    }
+
+    inline void storeVec3(glm::vec3 &out, __m128 v)
+    {
+        float t[4];
+        _mm_storeu_ps(t, v);
+        out = glm::vec3(t[0], t[1], t[2]);
+    }
+
+    void multiplySSE2(glm::mat4 const *a, size_t strideA, glm::mat4 const *b,
+            glm::mat4 *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float const *pa = &a[i * strideA][0][0];
+            float const *pb = &b[i][0][0];
+            float *po = &out[i][0][0];
+
+            __m128 a0 = _mm_loadu_ps(pa);
+            __m128 a1 = _mm_loadu_ps(pa + 4);
+            __m128 a2 = _mm_loadu_ps(pa + 8);
+            __m128 a3 = _mm_loadu_ps(pa + 12);
+
+            for (int j = 0; j < 4; j++)
+            {
+                __m128 bj = _mm_loadu_ps(pb + 4 * j);
+                __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bj, bj, 0x00));
+                r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bj, bj, 0x55)));
+                r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bj, bj, 0xAA)));
+                r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bj, bj, 0xFF)));
+                _mm_storeu_ps(po + 4 * j, r);
+            }
+        }
+    }
+
+    //! four at a time: the quaternions are transposed into x, y, z and w
+    //! lanes, the rotation is built lane wise and transposed back per
+    //! column
+    void composeSSE2(glm::vec3 const *t, glm::quat const *r, glm::vec3 const *s,
+            glm::mat4 *out, size_t count)
+    {
+        __m128 const one = _mm_set1_ps(1.0f);
+        __m128 const two = _mm_set1_ps(2.0f);
+        __m128 const zero = _mm_setzero_ps();
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_setr_ps(r[i].x, r[i + 1].x, r[i + 2].x, r[i + 3].x);
+            __m128 y = _mm_setr_ps(r[i].y, r[i + 1].y, r[i + 2].y, r[i + 3].y);
+            __m128 z = _mm_setr_ps(r[i].z, r[i + 1].z, r[i + 2].z, r[i + 3].z);
+            __m128 w = _mm_setr_ps(r[i].w, r[i + 1].w, r[i + 2].w, r[i + 3].w);
+
+            __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+            __m128 xz = _mm_mul_ps(x, z), xy = _mm_mul_ps(x, y), yz = _mm_mul_ps(y, z);
+            __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+            __m128 sx = _mm_setr_ps(s[i].x, s[i + 1].x, s[i + 2].x, s[i + 3].x);
+            __m128 sy = _mm_setr_ps(s[i].y, s[i + 1].y, s[i + 2].y, s[i + 3].y);
+            __m128 sz = _mm_setr_ps(s[i].z, s[i + 1].z, s[i + 2].z, s[i + 3].z);
+
+            __m128 c0[4] =
+            {
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                _mm_mul_ps(zero, sx)
+            };
+
+            __m128 c1[4] =
+            {
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                _mm_mul_ps(zero, sy)
+            };
+
+            __m128 c2[4] =
+            {
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                _mm_mul_ps(zero, sz)
+            };
+
+            _MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+            _MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+            _MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+
+            for (int k = 0; k < 4; k++)
+            {
+                float *po = &out[i + k][0][0];
+                _mm_storeu_ps(po, c0[k]);
+                _mm_storeu_ps(po + 4, c1[k]);
+                _mm_storeu_ps(po + 8, c2[k]);
+                _mm_storeu_ps(po + 12, _mm_setr_ps(t[i + k].x, t[i + k].y, t[i + k].z, 1.0f));
+            }
+        }
+
+        composeScalar(t + i, r + i, s + i, out + i, count - i);
+    }
+
+    void transformPointsSSE2(glm::mat4 const &m, glm::vec3 const *in, glm::vec3 *out, size_t count)
+    {
+        __m128 c0 = _mm_loadu_ps(&m[0][0]);
+        __m128 c1 = _mm_loadu_ps(&m[1][0]);
+        __m128 c2 = _mm_loadu_ps(&m[2][0]);
+        __m128 c3 = _mm_loadu_ps(&m[3][0]);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            __m128 lo = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[i].x)), _mm_mul_ps(c1, _mm_set1_ps(in[i].y)));
+            __m128 hi = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(in[i].z)), c3);
+            storeVec3(out[i], _mm_add_ps(lo, hi));
+        }
+    }
+
+    void transformAABBsSSE2(glm::mat4 const *m, mathkernels::SAABB const *in,
+            mathkernels::SAABB *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float const *pm = &m[i][0][0];
+            __m128 c0 = _mm_loadu_ps(pm);
+            __m128 c1 = _mm_loadu_ps(pm + 4);
+            __m128 c2 = _mm_loadu_ps(pm + 8);
+            __m128 c3 = _mm_loadu_ps(pm + 12);
+
+            glm::vec3 const c = in[i].center;
+            glm::vec3 const e = in[i].extent;
+
+            __m128 lo = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(c.x)), _mm_mul_ps(c1, _mm_set1_ps(c.y)));
+            __m128 hi = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(c.z)), c3);
+
+            __m128 extent = _mm_mul_ps(abs(c0), _mm_set1_ps(e.x));
+            extent = _mm_add_ps(extent, _mm_mul_ps(abs(c1), _mm_set1_ps(e.y)));
+            extent = _mm_add_ps(extent, _mm_mul_ps(abs(c2), _mm_set1_ps(e.z)));
+
+            storeVec3(out[i].center, _mm_add_ps(lo, hi));
+            storeVec3(out[i].extent, extent);
+        }
+    }
+
+    void cullSSE2(glm::vec4 const *planes, unsigned int planeCount,
+            mathkernels::SAABB const *boxes, glm::uint8 *visible, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            mathkernels::SAABB const *b = boxes + i;
+            __m128 cx = _mm_setr_ps(b[0].center.x, b[1].center.x, b[2].center.x, b[3].center.x);
+            __m128 cy = _mm_setr_ps(b[0].center.y, b[1].center.y, b[2].center.y, b[3].center.y);
+            __m128 cz = _mm_setr_ps(b[0].center.z, b[1].center.z, b[2].center.z, b[3].center.z);
+            __m128 ex = _mm_setr_ps(b[0].extent.x, b[1].extent.x, b[2].extent.x, b[3].extent.x);
+            __m128 ey = _mm_setr_ps(b[0].extent.y, b[1].extent.y, b[2].extent.y, b[3].extent.y);
+            __m128 ez = _mm_setr_ps(b[0].extent.z, b[1].extent.z, b[2].extent.z, b[3].extent.z);
+
+            __m128 outside = _mm_setzero_ps();
+            for (unsigned int p = 0; p < planeCount; p++)
+            {
+                glm::vec4 const &n = planes[p];
+
+                __m128 dist = _mm_mul_ps(_mm_set1_ps(n.x), cx);
+                dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(n.y), cy));
+                dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(n.z), cz));
+                dist = _mm_add_ps(dist, _mm_set1_ps(n.w));
+
+                __m128 radius = _mm_mul_ps(_mm_set1_ps(std::fabs(n.x)), ex);
+                radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::fabs(n.y)), ey));
+                radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::fabs(n.z)), ez));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            for (int k = 0; k < 4; k++)
+                visible[i + k] = ((mask >> k) & 1) ? 0 : 1;
+        }
+
+        cullScalar(planes, planeCount, boxes + i, visible + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    void multiplyAVX2(glm::mat4 const *a, size_t strideA, glm::mat4 const *b,
+            glm::mat4 *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float const *pa = &a[i * strideA][0][0];
+            float const *pb = &b[i][0][0];
+            float *po = &out[i][0][0];
+
+            //! two result columns per register, each half against its own
+            //! column of b
+            __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<__m128 const *>(pa));
+            __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<__m128 const *>(pa + 4));
+            __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<__m128 const *>(pa + 8));
+            __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<__m128 const *>(pa + 12));
+
+            __m256 b01 = _mm256_loadu_ps(pb);
+            __m256 b23 = _mm256_loadu_ps(pb + 8);
+
+            __m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+            r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(b01, 0x55)));
+            r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(b01, 0xAA)));
+            r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(b01, 0xFF)));
+
+            __m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+            r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(b23, 0x55)));
+            r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(b23, 0xAA)));
+            r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(b23, 0xFF)));
+
+            _mm256_storeu_ps(po, r01);
+            _mm256_storeu_ps(po + 8, r23);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void cullAVX2(glm::vec4 const *planes, unsigned int planeCount,
+            mathkernels::SAABB const *boxes, glm::uint8 *visible, size_t count)
+    {
+        //! a box is six floats, so eight boxes are 48 contiguous floats and
+        //! each field is a stride six gather
+        __m256i const stride = _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            float const *b = &boxes[i].center.x;
+            __m256 cx = _mm256_i32gather_ps(b + 0, stride, 4);
+            __m256 cy = _mm256_i32gather_ps(b + 1, stride, 4);
+            __m256 cz = _mm256_i32gather_ps(b + 2, stride, 4);
+            __m256 ex = _mm256_i32gather_ps(b + 3, stride, 4);
+            __m256 ey = _mm256_i32gather_ps(b + 4, stride, 4);
+            __m256 ez = _mm256_i32gather_ps(b + 5, stride, 4);
+
+            __m256 outside = _mm256_setzero_ps();
+            for (unsigned int p = 0; p < planeCount; p++)
+            {
+                glm::vec4 const &n = planes[p];
+
+                __m256 dist = _mm256_mul_ps(_mm256_set1_ps(n.x), cx);
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(n.y), cy));
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(n.z), cz));
+                dist = _mm256_add_ps(dist, _mm256_set1_ps(n.w));
+
+                __m256 radius = _mm256_mul_ps(_mm256_set1_ps(std::fabs(n.x)), ex);
+                radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::fabs(n.y)), ey));
+                radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::fabs(n.z)), ez));
+
+                outside = _mm256_or_ps(outside,
+                        _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+
+            int mask = _mm256_movemask_ps(outside);
+            for (int k = 0; k < 8; k++)
+                visible[i + k] = ((mask >> k) & 1) ? 0 : 1;
+        }
+
+        cullSSE2(planes, planeCount, boxes + i, visible + i, count - i);
+    }
+
+    //! avx-512 brings fma along, and a fused multiply-add rounds once
+    //! where glm rounds twice, so contraction is switched off here
+    __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    void multiplyAVX512(glm::mat4 const *a, size_t strideA, glm::mat4 const *b,
+            glm::mat4 *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float const *pa = &a[i * strideA][0][0];
+            float const *pb = &b[i][0][0];
+
+            //! the whole of b in one register, every 128 bit lane one
+            //! column of the result
+            __m512 a0 = _mm512_setr4_ps(pa[0], pa[1], pa[2], pa[3]);
+            __m512 a1 = _mm512_setr4_ps(pa[4], pa[5], pa[6], pa[7]);
+            __m512 a2 = _mm512_setr4_ps(pa[8], pa[9], pa[10], pa[11]);
+            __m512 a3 = _mm512_setr4_ps(pa[12], pa[13], pa[14], pa[15]);
+            __m512 bz = _mm512_loadu_ps(pb);
+
+            __m512 r = _mm512_mul_ps(a0, _mm512_shuffle_ps(bz, bz, 0x00));
+            r = _mm512_add_ps(r, _mm512_mul_ps(a1, _mm512_shuffle_ps(bz, bz, 0x55)));
+            r = _mm512_add_ps(r, _mm512_mul_ps(a2, _mm512_shuffle_ps(bz, bz, 0xAA)));
+            r = _mm512_add_ps(r, _mm512_mul_ps(a3, _mm512_shuffle_ps(bz, bz, 0xFF)));
+
+            _mm512_storeu_ps(&out[i][0][0], r);
+        }
+    }
+#endif
+
+    void multiplyAny(glm::mat4 const *a, size_t strideA, glm::mat4 const *b,
+            glm::mat4 *out, size_t count)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu::getPath() >= cpu::E_CP_AVX512)
+            return multiplyAVX512(a, strideA, b, out, count);
+        if (cpu::getPath() >= cpu::E_CP_AVX2)
+            return multiplyAVX2(a, strideA, b, out, count);
+        if (cpu::getPath() >= cpu::E_CP_SSE2)
+            return multiplySSE2(a, strideA, b, out, count);
+#endif
+        multiplyScalar(a, strideA, b, out, count);
+    }
+}
+
+void mathkernels::multiply(glm::mat4 const *a, glm::mat4 const *b, glm::mat4 *out, size_t count)
+{
+    multiplyAny(a, 1, b, out, count);
+}
+
+void mathkernels::multiply(glm::mat4 const &a, glm::mat4 const *b, glm::mat4 *out, size_t count)
+{
+    //! copied so that out may alias b even when a lives in b
+    glm::mat4 const left = a;
+    multiplyAny(&left, 0, b, out, count);
+}
+
+void mathkernels::compose(glm::vec3 const *t, glm::quat const *r, glm::vec3 const *s,
+        glm::mat4 *out, size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::getPath() >= cpu::E_CP_SSE2)
+        return composeSSE2(t, r, s, out, count);
+#endif
+    composeScalar(t, r, s, out, count);
+}
+
+void mathkernels::transformPoints(glm::mat4 const &m, glm::vec3 const *in, glm::vec3 *out, size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::getPath() >= cpu::E_CP_SSE2)
+        return transformPointsSSE2(m, in, out, count);
+#endif
+    transformPointsScalar(m, in, out, count);
+}
+
+void mathkernels::transformAABBs(glm::mat4 const *m, SAABB const *in, SAABB *out, size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::getPath() >= cpu::E_CP_SSE2)
+        return transformAABBsSSE2(m, in, out, count);
+#endif
+    transformAABBsScalar(m, in, out, count);
+}
+
+void mathkernels::extractFrustum(glm::mat4 const &viewProjection, glm::vec4 planes[6])
+{
+    glm::mat4 const &m = viewProjection;
+
+    //! rows of the combined matrix: left, right, bottom, top, near, far
+    for (int i = 0; i < 3; i++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            float sign = side ? -1.0f : 1.0f;
+            glm::vec4 &p = planes[i * 2 + side];
+
+            p = glm::vec4(m[0][3] + sign * m[0][i], m[1][3] + sign * m[1][i],
+                    m[2][3] + sign * m[2][i], m[3][3] + sign * m[3][i]);
+
+            float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+            if (length > 0.0f)
+                p = p * (1.0f / length);
+        }
+    }
+}
+
+void mathkernels::cullAABBs(glm::vec4 const *planes, unsigned int planeCount,
+        SAABB const *boxes, glm::uint8 *visible, size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu::getPath() >= cpu::E_CP_AVX2)
+        return cullAVX2(planes, planeCount, boxes, visible, count);
+    if (cpu::getPath() >= cpu::E_CP_SSE2)
+        return cullSSE2(planes, planeCount, boxes, visible, count);
+#endif
+    cullScalar(planes, planeCount, boxes, visible, count);
+}
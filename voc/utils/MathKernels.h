@@ -0,0 +1,64 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef _MATHKERNELS_H_
+#define _MATHKERNELS_H_
+
+#include "../Commons.h"
+#include "CpuFeatures.h"
+
+//! batch matrix, point and bounds kernels over plain arrays; every path
+//! rounds like the matching glm expression, so results are bit for bit
+//! the ones glm would give
+//!
+//! kernels without a dedicated avx2 or avx-512 body use the next
+//! narrower one
+namespace mathkernels
+{
+    struct SAABB
+    {
+        glm::vec3 center;
+        glm::vec3 extent;
+    };
+
+    //! out[i] = a[i] * b[i]; out may alias either input
+    void multiply(glm::mat4 const *a, glm::mat4 const *b, glm::mat4 *out, size_t count);
+
+    //! out[i] = a * b[i]
+    void multiply(glm::mat4 const &a, glm::mat4 const *b, glm::mat4 *out, size_t count);
+
+    //! out[i] = translate(t[i]) * mat4_cast(r[i]) * scale(s[i])
+    void compose(glm::vec3 const *t, glm::quat const *r, glm::vec3 const *s,
+            glm::mat4 *out, size_t count);
+
+    //! out[i] = (m * vec4(in[i], 1)).xyz
+    void transformPoints(glm::mat4 const &m, glm::vec3 const *in, glm::vec3 *out, size_t count);
+
+    //! box around each transformed box: center through m[i], extent
+    //! through the absolute upper 3x3
+    void transformAABBs(glm::mat4 const *m, SAABB const *in, SAABB *out, size_t count);
+
+    //! planes (n, d) with n.p + d >= 0 on the inside, normalised
+    void extractFrustum(glm::mat4 const &viewProjection, glm::vec4 planes[6]);
+
+    //! visible[i] is 0 when box i lies entirely behind any plane, 1
+    //! otherwise
+    void cullAABBs(glm::vec4 const *planes, unsigned int planeCount,
+            SAABB const *boxes, glm::uint8 *visible, size_t count);
+}
+
+#endif /* end of include guard: _MATHKERNELS_H_ */
@@ -0,0 +1,180 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include "../Commons.h"
+
+//! dense resource registry: values sit contiguously and are walked in
+//! place, handles go through one indirection and carry a generation so a
+//! handle to an erased value never resolves to whatever reused its slot
+//!
+//! a handle is (generation << INDEX_BITS) | slot; erasing swaps the last
+//! value into the hole, so pointers returned by get() only live until the
+//! next insert or erase
+template <typename T>
+class CSlotMap
+{
+public:
+    static const glm::uint32 INVALID_HANDLE = 0xFFFFFFFF;
+
+    explicit CSlotMap() : m_nFreeSlot(END) {}
+
+    glm::uint32 insert(T const &value)
+    {
+        glm::uint32 slot = acquireSlot();
+        m_vData.push_back(value);
+        return bind(slot);
+    }
+
+    glm::uint32 insert(T &&value)
+    {
+        glm::uint32 slot = acquireSlot();
+        m_vData.push_back(std::move(value));
+        return bind(slot);
+    }
+
+    bool erase(glm::uint32 handle)
+    {
+        if (!contains(handle))
+            return false;
+
+        glm::uint32 slot = handle & INDEX_MASK;
+        glm::uint32 index = m_vSlot[slot].index;
+        glm::uint32 last = m_vData.size() - 1;
+
+        if (index != last)
+        {
+            m_vData[index] = std::move(m_vData[last]);
+            m_vDataSlot[index] = m_vDataSlot[last];
+            m_vSlot[m_vDataSlot[index]].index = index;
+        }
+
+        m_vData.pop_back();
+        m_vDataSlot.pop_back();
+
+        //! the generation never lands on the one that would spell out
+        //! INVALID_HANDLE, and the slot joins the free list
+        SSlot &s = m_vSlot[slot];
+        s.generation = (s.generation + 1) & GENERATION_MASK;
+        if (slot == INDEX_MASK && s.generation == GENERATION_MASK)
+            s.generation = 0;
+
+        s.index = m_nFreeSlot;
+        m_nFreeSlot = slot;
+        return true;
+    }
+
+    bool contains(glm::uint32 handle) const
+    {
+        glm::uint32 slot = handle & INDEX_MASK;
+        return slot < m_vSlot.size() &&
+            m_vSlot[slot].generation == (handle >> INDEX_BITS) &&
+            m_vSlot[slot].index < m_vData.size() &&
+            m_vDataSlot[m_vSlot[slot].index] == slot;
+    }
+
+    T *get(glm::uint32 handle)
+    {
+        return contains(handle) ? &m_vData[m_vSlot[handle & INDEX_MASK].index] : nullptr;
+    }
+
+    T const *get(glm::uint32 handle) const
+    {
+        return contains(handle) ? &m_vData[m_vSlot[handle & INDEX_MASK].index] : nullptr;
+    }
+
+    //! handle of the value at a dense position, for walks over begin/end
+    glm::uint32 getHandle(size_t index) const
+    {
+        glm::uint32 slot = m_vDataSlot[index];
+        return (m_vSlot[slot].generation << INDEX_BITS) | slot;
+    }
+
+    void reserve(size_t count)
+    {
+        m_vData.reserve(count);
+        m_vDataSlot.reserve(count);
+        m_vSlot.reserve(count);
+    }
+
+    void clear()
+    {
+        while (!m_vData.empty())
+            erase(getHandle(m_vData.size() - 1));
+    }
+
+    size_t size() const { return m_vData.size(); }
+    bool empty() const { return m_vData.empty(); }
+
+    T *begin() { return m_vData.empty() ? nullptr : &m_vData[0]; }
+    T *end() { return begin() + m_vData.size(); }
+    T const *begin() const { return m_vData.empty() ? nullptr : &m_vData[0]; }
+    T const *end() const { return begin() + m_vData.size(); }
+
+    T &operator[](size_t index) { return m_vData[index]; }
+    T const &operator[](size_t index) const { return m_vData[index]; }
+
+private:
+    enum
+    {
+        INDEX_BITS = 20,
+        INDEX_MASK = (1 << INDEX_BITS) - 1,
+        GENERATION_MASK = (1 << (32 - INDEX_BITS)) - 1,
+        END = 0xFFFFFFFF
+    };
+
+    struct SSlot
+    {
+        //! dense position while live, next free slot while on the list
+        glm::uint32 index;
+        glm::uint32 generation;
+    };
+
+    glm::uint32 acquireSlot()
+    {
+        if (m_nFreeSlot != glm::uint32(END))
+        {
+            glm::uint32 slot = m_nFreeSlot;
+            m_nFreeSlot = m_vSlot[slot].index;
+            return slot;
+        }
+
+        assert(m_vSlot.size() <= INDEX_MASK);
+
+        SSlot s;
+        s.index = 0;
+        s.generation = 0;
+        m_vSlot.push_back(s);
+        return m_vSlot.size() - 1;
+    }
+
+    glm::uint32 bind(glm::uint32 slot)
+    {
+        m_vSlot[slot].index = m_vData.size() - 1;
+        m_vDataSlot.push_back(slot);
+        return (m_vSlot[slot].generation << INDEX_BITS) | slot;
+    }
+
+    std::vector<T> m_vData;
+    std::vector<glm::uint32> m_vDataSlot;
+    std::vector<SSlot> m_vSlot;
+    glm::uint32 m_nFreeSlot;
+};
+
+#endif /* end of include guard: SLOTMAP_H */
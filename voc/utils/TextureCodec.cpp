@@ -0,0 +1,407 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "TextureCodec.h"
+
+namespace
+{
+    //! gathers a 4x4 block, texels past the edge repeat the last row and
+    //! column so partial blocks stay well formed
+    void fetchBlock(glm::uint8 const *rgba, unsigned int width, unsigned int height,
+            unsigned int bx, unsigned int by, glm::uint8 block[16][4])
+    {
+        for (unsigned int y = 0; y < 4; y++)
+        {
+            unsigned int sy = std::min(by * 4 + y, height - 1);
+            for (unsigned int x = 0; x < 4; x++)
+            {
+                unsigned int sx = std::min(bx * 4 + x, width - 1);
+                memcpy(block[y * 4 + x], rgba + (size_t(sy) * width + sx) * 4, 4);
+            }
+        }
+    }
+
+    void storeBlock(glm::uint8 *rgba, unsigned int width, unsigned int height,
+            unsigned int bx, unsigned int by, glm::uint8 const block[16][4])
+    {
+        for (unsigned int y = 0; y < 4 && by * 4 + y < height; y++)
+            for (unsigned int x = 0; x < 4 && bx * 4 + x < width; x++)
+                memcpy(rgba + (size_t(by * 4 + y) * width + bx * 4 + x) * 4, block[y * 4 + x], 4);
+    }
+
+    glm::uint16 pack565(glm::uint8 const *c)
+    {
+        return glm::uint16(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+    }
+
+    void unpack565(glm::uint16 v, glm::uint8 *c)
+    {
+        glm::uint8 r = (v >> 11) & 0x1F;
+        glm::uint8 g = (v >> 5) & 0x3F;
+        glm::uint8 b = v & 0x1F;
+
+        c[0] = (r << 3) | (r >> 2);
+        c[1] = (g << 2) | (g >> 4);
+        c[2] = (b << 3) | (b >> 2);
+        c[3] = 255;
+    }
+
+    //! range fit along the bounding box diagonal, the box is inset by a
+    //! sixteenth to pull the endpoints away from outliers
+    void encodeColor(glm::uint8 const block[16][4], glm::uint8 *out)
+    {
+        glm::uint8 lo[3] = { 255, 255, 255 };
+        glm::uint8 hi[3] = { 0, 0, 0 };
+
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+            {
+                lo[c] = std::min(lo[c], block[i][c]);
+                hi[c] = std::max(hi[c], block[i][c]);
+            }
+
+        for (int c = 0; c < 3; c++)
+        {
+            int inset = (hi[c] - lo[c]) >> 4;
+            lo[c] = glm::uint8(lo[c] + inset);
+            hi[c] = glm::uint8(hi[c] - inset);
+        }
+
+        glm::uint16 c0 = pack565(hi);
+        glm::uint16 c1 = pack565(lo);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        glm::uint32 indices = 0;
+        if (c0 != c1)
+        {
+            glm::uint8 palette[4][4];
+            unpack565(c0, palette[0]);
+            unpack565(c1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = glm::uint8((2 * palette[0][c] + palette[1][c]) / 3);
+                palette[3][c] = glm::uint8((palette[0][c] + 2 * palette[1][c]) / 3);
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                int bestError = INT_MAX;
+                for (int p = 0; p < 4; p++)
+                {
+                    int error = 0;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        int d = int(block[i][c]) - int(palette[p][c]);
+                        error += d * d;
+                    }
+
+                    if (error < bestError)
+                    {
+                        best = p;
+                        bestError = error;
+                    }
+                }
+
+                indices |= glm::uint32(best) << (i * 2);
+            }
+        }
+
+        out[0] = c0 & 0xFF;
+        out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF;
+        out[3] = c1 >> 8;
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+
+    void decodeColor(glm::uint8 const *in, glm::uint8 block[16][4], bool opaque)
+    {
+        glm::uint16 c0 = glm::uint16(in[0] | (in[1] << 8));
+        glm::uint16 c1 = glm::uint16(in[2] | (in[3] << 8));
+
+        glm::uint8 palette[4][4];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+
+        if (c0 > c1 || opaque)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = glm::uint8((2 * palette[0][c] + palette[1][c]) / 3);
+                palette[3][c] = glm::uint8((palette[0][c] + 2 * palette[1][c]) / 3);
+            }
+            palette[2][3] = palette[3][3] = 255;
+        }
+        else
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = glm::uint8((palette[0][c] + palette[1][c]) / 2);
+                palette[3][c] = 0;
+            }
+            palette[2][3] = 255;
+            palette[3][3] = 0;
+        }
+
+        glm::uint32 indices = in[4] | (in[5] << 8) | (in[6] << 16) | (glm::uint32(in[7]) << 24);
+        for (int i = 0; i < 16; i++)
+            memcpy(block[i], palette[(indices >> (i * 2)) & 3], 4);
+    }
+
+    //! eight value mode only: endpoints are the channel extremes so the
+    //! interpolated ramp always spans the block
+    void encodeChannel(glm::uint8 const block[16][4], int channel, glm::uint8 *out)
+    {
+        glm::uint8 lo = 255, hi = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            lo = std::min(lo, block[i][channel]);
+            hi = std::max(hi, block[i][channel]);
+        }
+
+        glm::uint64 indices = 0;
+        if (hi != lo)
+        {
+            //! palette order is a0, a1, then six steps from a0 towards a1
+            static int const remap[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+            for (int i = 0; i < 16; i++)
+            {
+                int step = ((hi - block[i][channel]) * 7 + (hi - lo) / 2) / (hi - lo);
+                indices |= glm::uint64(remap[step]) << (i * 3);
+            }
+        }
+
+        out[0] = hi;
+        out[1] = lo;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+
+    void decodeChannel(glm::uint8 const *in, int channel, glm::uint8 block[16][4])
+    {
+        int a0 = in[0], a1 = in[1];
+
+        glm::uint8 palette[8];
+        palette[0] = glm::uint8(a0);
+        palette[1] = glm::uint8(a1);
+        if (a0 > a1)
+        {
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = glm::uint8(((7 - i) * a0 + i * a1) / 7);
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+                palette[i + 1] = glm::uint8(((5 - i) * a0 + i * a1) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        glm::uint64 indices = 0;
+        for (int i = 0; i < 6; i++)
+            indices |= glm::uint64(in[2 + i]) << (i * 8);
+
+        for (int i = 0; i < 16; i++)
+            block[i][channel] = palette[(indices >> (i * 3)) & 7];
+    }
+
+    size_t getBlockSize(texcodec::EFormat format)
+    {
+        switch (format)
+        {
+            case texcodec::E_TF_BC1:
+            case texcodec::E_TF_BC4:
+                return 8;
+            case texcodec::E_TF_BC3:
+            case texcodec::E_TF_BC5:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+}
+
+size_t texcodec::getLevelSize(EFormat format, unsigned int width, unsigned int height)
+{
+    if (format == E_TF_RGBA8)
+        return size_t(width) * height * 4;
+
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+GLenum texcodec::getInternalFormat(EFormat format)
+{
+    switch (format)
+    {
+        case E_TF_BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case E_TF_BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case E_TF_BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case E_TF_BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        default:
+            return GL_RGBA8;
+    }
+}
+
+bool texcodec::isSupported(EFormat format)
+{
+    switch (format)
+    {
+        case E_TF_BC1:
+        case E_TF_BC3:
+            return GLEW_EXT_texture_compression_s3tc;
+        case E_TF_BC4:
+        case E_TF_BC5:
+            return GLEW_ARB_texture_compression_rgtc || GLEW_VERSION_3_0;
+        default:
+            return true;
+    }
+}
+
+bool texcodec::validate(char const *data, size_t size)
+{
+    if (size < sizeof(SHeader))
+        return false;
+
+    SHeader const *header = reinterpret_cast<SHeader const *>(data);
+    if (memcmp(header->magic, "VTC1", 4) != 0 || header->version != 1)
+        return false;
+
+    if (header->format >= E_TF_MAX || header->levels == 0 || header->levels > MAX_LEVELS ||
+            header->width == 0 || header->height == 0)
+        return false;
+
+    for (glm::uint32 i = 0; i < header->levels; i++)
+    {
+        SLevel const &level = header->level[i];
+        if (level.width != std::max(header->width >> i, 1u) ||
+                level.height != std::max(header->height >> i, 1u) ||
+                level.size != getLevelSize(EFormat(header->format), level.width, level.height) ||
+                glm::uint64(level.offset) + level.size > size)
+            return false;
+    }
+
+    return true;
+}
+
+void texcodec::encode(EFormat format, glm::uint8 const *rgba,
+        unsigned int width, unsigned int height,
+        std::vector<glm::uint8> &out)
+{
+    out.resize(getLevelSize(format, width, height));
+
+    if (format == E_TF_RGBA8)
+    {
+        memcpy(&out[0], rgba, out.size());
+        return;
+    }
+
+    unsigned int bw = (width + 3) / 4;
+    unsigned int bh = (height + 3) / 4;
+    size_t stride = getBlockSize(format);
+
+    //! blocks are independent, rows of them go to separate threads
+    #pragma omp parallel for schedule(dynamic)
+    for (int by = 0; by < int(bh); by++)
+    {
+        glm::uint8 block[16][4];
+        for (unsigned int bx = 0; bx < bw; bx++)
+        {
+            glm::uint8 *dst = &out[(size_t(by) * bw + bx) * stride];
+            fetchBlock(rgba, width, height, bx, by, block);
+
+            switch (format)
+            {
+                case E_TF_BC1:
+                    encodeColor(block, dst);
+                    break;
+                case E_TF_BC3:
+                    encodeChannel(block, 3, dst);
+                    encodeColor(block, dst + 8);
+                    break;
+                case E_TF_BC4:
+                    encodeChannel(block, 0, dst);
+                    break;
+                case E_TF_BC5:
+                    encodeChannel(block, 0, dst);
+                    encodeChannel(block, 1, dst + 8);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void texcodec::decode(EFormat format, glm::uint8 const *data,
+        unsigned int width, unsigned int height,
+        std::vector<glm::uint8> &rgba)
+{
+    rgba.resize(size_t(width) * height * 4);
+
+    if (format == E_TF_RGBA8)
+    {
+        memcpy(&rgba[0], data, rgba.size());
+        return;
+    }
+
+    unsigned int bw = (width + 3) / 4;
+    unsigned int bh = (height + 3) / 4;
+    size_t stride = getBlockSize(format);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int by = 0; by < int(bh); by++)
+    {
+        glm::uint8 block[16][4];
+        for (unsigned int bx = 0; bx < bw; bx++)
+        {
+            glm::uint8 const *src = data + (size_t(by) * bw + bx) * stride;
+            memset(block, 0, sizeof(block));
+
+            switch (format)
+            {
+                case E_TF_BC1:
+                    decodeColor(src, block, false);
+                    break;
+                case E_TF_BC3:
+                    decodeColor(src + 8, block, true);
+                    decodeChannel(src, 3, block);
+                    break;
+                case E_TF_BC4:
+                    decodeChannel(src, 0, block);
+                    for (int i = 0; i < 16; i++)
+                        block[i][3] = 255;
+                    break;
+                case E_TF_BC5:
+                    decodeChannel(src, 0, block);
+                    decodeChannel(src + 8, 1, block);
+                    for (int i = 0; i < 16; i++)
+                        block[i][3] = 255;
+                    break;
+                default:
+                    break;
+            }
+
+            storeBlock(&rgba[0], width, height, bx, by, block);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef _TEXTURECODEC_H_
+#define _TEXTURECODEC_H_
+
+#include "../Commons.h"
+
+//! block compression and the mipmapped texture container written by
+//! voc-texc and read back by CTextureManager
+namespace texcodec
+{
+    enum EFormat
+    {
+        E_TF_RGBA8 = 0,
+        E_TF_BC1,       //!< S3TC DXT1, opaque RGB
+        E_TF_BC3,       //!< S3TC DXT5, RGB plus interpolated alpha
+        E_TF_BC4,       //!< RGTC1, single channel taken from red
+        E_TF_BC5,       //!< RGTC2, two channels taken from red and green
+        E_TF_MAX
+    };
+
+    static const unsigned int MAX_LEVELS = 16;
+
+    struct SLevel
+    {
+        glm::uint32 offset;
+        glm::uint32 size;
+        glm::uint32 width;
+        glm::uint32 height;
+    };
+
+    //! container layout, read in place from an mmap: the fixed header is
+    //! followed by every mip level, each starting on a 16 byte boundary
+    struct SHeader
+    {
+        char magic[4];
+        glm::uint32 version;
+        glm::uint32 format;
+        glm::uint32 width;
+        glm::uint32 height;
+        glm::uint32 levels;
+        SLevel level[MAX_LEVELS];
+    };
+
+    size_t getLevelSize(EFormat format, unsigned int width, unsigned int height);
+    GLenum getInternalFormat(EFormat format);
+    bool isSupported(EFormat format);
+    bool validate(char const *data, size_t size);
+
+    //! rgba is tightly packed, four bytes per texel
+    void encode(EFormat format, glm::uint8 const *rgba,
+            unsigned int width, unsigned int height,
+            std::vector<glm::uint8> &out);
+    void decode(EFormat format, glm::uint8 const *data,
+            unsigned int width, unsigned int height,
+            std::vector<glm::uint8> &rgba);
+}
+
+#endif /* end of include guard: _TEXTURECODEC_H_ */
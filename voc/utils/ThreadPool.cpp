@@ -0,0 +1,91 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#include "ThreadPool.h"
+
+CThreadPool::CThreadPool(unsigned int threads)
+    : m_nBusy(0),
+    m_bStopping(false)
+{
+    //! leave a core for the render thread
+    if (threads == 0)
+        threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+    for (unsigned int i = 0; i < threads; i++)
+        m_vThread.push_back(std::thread(&CThreadPool::work, this));
+}
+
+CThreadPool::~CThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sMutex);
+        m_bStopping = true;
+    }
+
+    m_sWake.notify_all();
+
+    std::vector<std::thread>::iterator i = m_vThread.begin();
+    for (; i != m_vThread.end(); i++)
+        i->join();
+}
+
+void CThreadPool::enqueue(std::function<void()> const &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sMutex);
+        m_dJob.push_back(job);
+    }
+
+    m_sWake.notify_one();
+}
+
+void CThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_sMutex);
+    while (!m_dJob.empty() || m_nBusy > 0)
+        m_sIdle.wait(lock);
+}
+
+void CThreadPool::work()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_sMutex);
+            while (m_dJob.empty() && !m_bStopping)
+                m_sWake.wait(lock);
+
+            if (m_dJob.empty())
+                return;
+
+            job = m_dJob.front();
+            m_dJob.pop_front();
+            m_nBusy++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_sMutex);
+            m_nBusy--;
+            if (m_dJob.empty() && m_nBusy == 0)
+                m_sIdle.notify_all();
+        }
+    }
+}
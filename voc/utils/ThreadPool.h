@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) Fitz Abucay, 2014
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "../Commons.h"
+
+//! fixed set of workers draining a shared job queue; loops that just need
+//! splitting across cores use OpenMP instead, this is for work that must
+//! outlive the call that queued it
+class CThreadPool
+{
+public:
+    explicit CThreadPool(unsigned int threads = 0);
+    ~CThreadPool();
+
+    void enqueue(std::function<void()> const &job);
+    void wait();
+
+    unsigned int getThreadCount() const { return m_vThread.size(); }
+
+private:
+    CThreadPool(const CThreadPool &tp);
+    CThreadPool& operator=(const CThreadPool &tp);
+
+    void work();
+
+    std::vector<std::thread> m_vThread;
+    std::deque<std::function<void()> > m_dJob;
+
+    std::mutex m_sMutex;
+    std::condition_variable m_sWake;
+    std::condition_variable m_sIdle;
+
+    unsigned int m_nBusy;
+    bool m_bStopping;
+};
+
+#endif /* end of include guard: THREADPOOL_H */